@@ -1,623 +1,4480 @@
+#define _DEFAULT_SOURCE // madvise e outras extensões POSIX também com -std=c11
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h> 
+#include <time.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <math.h>
+#include <signal.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//------------ Execucao -------------------
+bool modo_silencioso = false;      // Não imprime nada por requisição, só o resumo final
+int intervalo_dump = 0;            // No modo silencioso, mostra a memória a cada N requisições (0 = nunca)
+
+typedef struct Instrumentacao Instrumentacao;
+
+// Contadores de uma simulação (cada instância de memória tem os seus)
+typedef struct Contadores {
+    long requisicoes;
+    long alocacoes;        // INs atendidos
+    long falhas;           // INs recusados por falta de espaço
+    long liberacoes;       // OUTs que encontraram o processo
+
+    // Custo da requisição em andamento, somado pelas políticas e registrado no fim dela
+    long visitados;        // Nós examinados nas estruturas (busca, vizinhos, ancestrais)
+    long divisoes;
+    long fusoes;
+    uint64_t ciclo_inicio;
+    int op;
+    Instrumentacao *inst;  // Histogramas; NULL = instrumentação desligada
+} Contadores;
+
+// Mensagens por requisição: suprimidas no modo silencioso
+#define LOG(...) do { if (!modo_silencioso) printf(__VA_ARGS__); } while (0)
+
+void zerar_contadores(Contadores *c) {
+    memset(c, 0, sizeof(Contadores));
+}
+
+// ---- Instrumentação por requisição ----
+// Histogramas no estilo HDR: valores até HIST_SUB são exatos; acima disso, cada potência de 2
+// é dividida em HIST_SUB baldes (erro relativo de até 1/HIST_SUB).
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BALDES (HIST_SUB + (64 - HIST_SUB_BITS) * HIST_SUB)
+#define METRICA_VISITADOS 0
+#define METRICA_DIVISOES 1
+#define METRICA_FUSOES 2
+#define METRICA_CICLOS 3
+#define QTD_METRICAS 4
+
+typedef struct Histograma {
+    uint64_t baldes[HIST_BALDES];
+    uint64_t qtd;
+    uint64_t soma;
+    uint64_t max;
+} Histograma;
+
+struct Instrumentacao {
+    const char *politica;
+    Histograma hist[2][QTD_METRICAS];   // [IN = 0, OUT = 1][métrica]
+};
+
+const char *nomes_metricas[QTD_METRICAS] = {"visitados", "divisoes", "fusoes", "ciclos"};
+FILE *saida_instrumentacao = NULL;              // Destino do JSON; NULL = instrumentação desligada
+volatile sig_atomic_t dump_pedido = 0;          // Ligado pelo SIGUSR1
+
+void pedir_dump(int sinal) {
+    (void)sinal;
+    dump_pedido = 1;
+}
+
+// Ciclos do processador (TSC no x86; nos demais, nanossegundos do relógio monotônico)
+uint64_t ler_ciclos() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+int balde_histograma(uint64_t valor) {
+    if (valor < HIST_SUB) return (int)valor;
+    int e = 63 - __builtin_clzll(valor);
+    return HIST_SUB + (e - HIST_SUB_BITS) * HIST_SUB + (int)((valor >> (e - HIST_SUB_BITS)) - HIST_SUB);
+}
+
+// Menor valor que cai no balde
+uint64_t inicio_balde(int balde) {
+    if (balde < HIST_SUB) return balde;
+    int e = (balde - HIST_SUB) / HIST_SUB + HIST_SUB_BITS;
+    return (uint64_t)(HIST_SUB + (balde - HIST_SUB) % HIST_SUB) << (e - HIST_SUB_BITS);
+}
+
+void histograma_registrar(Histograma *h, uint64_t valor) {
+    h->baldes[balde_histograma(valor)]++;
+    h->qtd++;
+    h->soma += valor;
+    if (valor > h->max) h->max = valor;
+}
+
+// Percentil p (0 a 1), pelo início do balde
+uint64_t histograma_percentil(const Histograma *h, double p) {
+    uint64_t alvo = (uint64_t)ceil(p * h->qtd), acumulado = 0;
+    if (alvo == 0) alvo = 1;
+    for (int i = 0; i < HIST_BALDES; i++) {
+        acumulado += h->baldes[i];
+        if (acumulado >= alvo) return inicio_balde(i);
+    }
+    return h->max;
+}
+
+void histograma_json(FILE *f, const Histograma *h) {
+    fprintf(f, "{\"qtd\": %" PRIu64 ", \"media\": %.2f, \"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+            ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %" PRIu64 ", \"baldes\": [",
+            h->qtd, h->qtd ? (double)h->soma / h->qtd : 0.0, histograma_percentil(h, 0.5),
+            histograma_percentil(h, 0.9), histograma_percentil(h, 0.99), histograma_percentil(h, 0.999), h->max);
+    bool primeiro = true;
+    for (int i = 0; i < HIST_BALDES; i++) {
+        if (h->baldes[i] == 0) continue;
+        fprintf(f, "%s[%" PRIu64 ", %" PRIu64 "]", primeiro ? "" : ", ", inicio_balde(i), h->baldes[i]);
+        primeiro = false;
+    }
+    fprintf(f, "]}");
+}
+
+// Uma linha JSON com todos os histogramas da instância
+void instrumentacao_dump(Instrumentacao *inst, const Contadores *c) {
+    FILE *f = saida_instrumentacao;
+    fprintf(f, "{\"politica\": \"%s\", \"requisicoes\": %ld", inst->politica, c->requisicoes);
+    for (int op = 0; op < 2; op++) {
+        fprintf(f, ", \"%s\": {", op == 0 ? "in" : "out");
+        for (int m = 0; m < QTD_METRICAS; m++) {
+            fprintf(f, "%s\"%s\": ", m ? ", " : "", nomes_metricas[m]);
+            histograma_json(f, &inst->hist[op][m]);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "}\n");
+    fflush(f);
+}
+
+// Liga a instrumentação nos contadores de uma instância, se --instrumentar foi pedido
+void instrumentacao_iniciar(Contadores *c, const char *politica) {
+    if (saida_instrumentacao == NULL) return;
+    c->inst = calloc(1, sizeof(Instrumentacao));
+    if (c->inst == NULL) {
+        perror("Erro ao alocar os histogramas");
+        exit(EXIT_FAILURE);
+    }
+    c->inst->politica = politica;
+}
+
+// Dump final e liberação dos histogramas
+void instrumentacao_finalizar(Contadores *c) {
+    if (c->inst == NULL) return;
+    instrumentacao_dump(c->inst, c);
+    free(c->inst);
+    c->inst = NULL;
+}
+
+// Início de uma requisição: zera o custo e marca o ciclo
+void iniciar_requisicao(Contadores *c, int op) {
+    c->visitados = c->divisoes = c->fusoes = 0;
+    c->op = op;
+    if (c->inst) c->ciclo_inicio = ler_ciclos();
+}
+
+// Fim de uma requisição: registra o custo nos histogramas e atende um SIGUSR1 pendente
+void registrar_requisicao(Contadores *c) {
+    if (c->inst == NULL) return;
+    uint64_t ciclos = ler_ciclos() - c->ciclo_inicio;
+    Histograma *h = c->inst->hist[c->op];
+    histograma_registrar(&h[METRICA_VISITADOS], c->visitados);
+    histograma_registrar(&h[METRICA_DIVISOES], c->divisoes);
+    histograma_registrar(&h[METRICA_FUSOES], c->fusoes);
+    histograma_registrar(&h[METRICA_CICLOS], ciclos);
+    if (dump_pedido) {
+        dump_pedido = 0;
+        instrumentacao_dump(c->inst, c);
+    }
+}
+
+// Conta a requisição e diz se o estado da memória deve ser mostrado depois dela
+bool deve_mostrar_estado(Contadores *c) {
+    registrar_requisicao(c);
+    c->requisicoes++;
+    if (!modo_silencioso) return true;
+    if (intervalo_dump > 0 && c->requisicoes % intervalo_dump == 0) {
+        printf("\n=== Estado apos %ld requisicoes ===\n", c->requisicoes);
+        return true;
+    }
+    return false;
+}
+
+double agora_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define SAIDA_TEXTO 0
+#define SAIDA_CSV 1
+#define SAIDA_JSON 2
+
+int formato_saida = SAIDA_TEXTO;
+
+// Ocupação da memória em um instante. Cada política mantém os totais a cada alocação, divisão,
+// fusão e liberação, então ler este estado custa O(1) e pode ser feito a cada requisição.
+typedef struct Fragmentacao {
+    uint64_t livre;         // KB livres
+    uint64_t maior_livre;   // Maior bloco livre (KB)
+    int blocos_livres;
+    uint64_t frag_interna;  // KB reservados além do pedido (só no Buddy)
+} Fragmentacao;
+
+// Índice de fragmentação externa: 1 - maior livre / total livre (0 = todo o espaço livre é contíguo)
+double frag_externa(const Fragmentacao *f) {
+    return f->livre ? 1.0 - (double)f->maior_livre / f->livre : 0.0;
+}
+
+// Resultado de uma execução, preenchido pela política ao final do arquivo
+typedef struct Resumo {
+    const char *politica;
+    uint64_t tam_mem;       // KB
+    long requisicoes;
+    long alocacoes;
+    long falhas;
+    long liberacoes;
+    uint64_t livre_total;   // KB livres
+    uint64_t maior_livre;   // Maior bloco livre (KB)
+    int blocos_livres;
+    int nos;                // Nós na lista de blocos
+    uint64_t frag_interna;  // KB (só no Buddy)
+    double frag_externa;    // Ver frag_externa()
+    long coalescencias;
+    long compactacoes;      // Particionamento variável com --compactar
+    long falhas_evitadas;   // INs atendidos graças a uma compactação
+    uint64_t kb_movidos;    // KB de blocos alocados realocados pelas compactações
+    double ms_compactacao;
+    long fusoes_adiadas;    // Buddy com --adiar: liberações que não tentaram a fusão
+    long descarregamentos;  // Vezes em que as fusões pendentes foram feitas
+    long divisoes_evitadas; // Em relação à mesma execução com fusão imediata (negativo = trabalho a mais)
+    long fusoes_evitadas;
+    long pico_nos;          // Pico de nós do pool
+    long chamadas_evitadas; // Chamadas ao malloc/free evitadas pelo pool
+} Resumo;
+
+// Preenche o início do resumo, comum a todas as políticas
+void iniciar_resumo(Resumo *r, const char *politica, uint64_t tam_mem, const Contadores *c, const Fragmentacao *f) {
+    memset(r, 0, sizeof(Resumo));
+    r->politica = politica;
+    r->tam_mem = tam_mem;
+    r->requisicoes = c->requisicoes;
+    r->alocacoes = c->alocacoes;
+    r->falhas = c->falhas;
+    r->liberacoes = c->liberacoes;
+    r->livre_total = f->livre;
+    r->maior_livre = f->maior_livre;
+    r->blocos_livres = f->blocos_livres;
+    r->frag_interna = f->frag_interna;
+    r->frag_externa = frag_externa(f);
+}
+
+#define CABECALHO_CSV "politica,memoria_kb,requisicoes,alocacoes,falhas,liberacoes,livre_kb,maior_livre_kb," \
+                      "blocos_livres,nos,frag_interna_kb,frag_externa,coalescencias,compactacoes,falhas_evitadas,kb_movidos," \
+                      "ms_compactacao,fusoes_adiadas,descarregamentos,divisoes_evitadas,fusoes_evitadas,pico_nos,chamadas_evitadas"
+
+// Campos do resumo em CSV, sem a quebra de linha (a varredura acrescenta colunas)
+void imprimir_campos_csv(const Resumo *r) {
+    printf("%s,%" PRIu64 ",%ld,%ld,%ld,%ld,%" PRIu64 ",%" PRIu64 ",%d,%d,%" PRIu64 ",%.4f,%ld,%ld,%ld,%" PRIu64 ",%.3f,"
+           "%ld,%ld,%ld,%ld,%ld,%ld",
+           r->politica, r->tam_mem, r->requisicoes, r->alocacoes, r->falhas, r->liberacoes,
+           r->livre_total, r->maior_livre, r->blocos_livres, r->nos, r->frag_interna, r->frag_externa,
+           r->coalescencias, r->compactacoes, r->falhas_evitadas, r->kb_movidos, r->ms_compactacao,
+           r->fusoes_adiadas, r->descarregamentos, r->divisoes_evitadas, r->fusoes_evitadas,
+           r->pico_nos, r->chamadas_evitadas);
+}
+
+void imprimir_resumo(const Resumo *r) {
+    if (formato_saida == SAIDA_CSV) {
+        printf(CABECALHO_CSV "\n");
+        imprimir_campos_csv(r);
+        printf("\n");
+    } else if (formato_saida == SAIDA_JSON) {
+        printf("{\"politica\": \"%s\", \"memoria_kb\": %" PRIu64 ", \"requisicoes\": %ld, \"alocacoes\": %ld, "
+               "\"falhas\": %ld, \"liberacoes\": %ld, \"livre_kb\": %" PRIu64 ", \"maior_livre_kb\": %" PRIu64 ", "
+               "\"blocos_livres\": %d, \"nos\": %d, \"frag_interna_kb\": %" PRIu64 ", \"frag_externa\": %.4f, "
+               "\"coalescencias\": %ld, \"compactacoes\": %ld, \"falhas_evitadas\": %ld, \"kb_movidos\": %" PRIu64 ", "
+               "\"ms_compactacao\": %.3f, \"fusoes_adiadas\": %ld, \"descarregamentos\": %ld, "
+               "\"divisoes_evitadas\": %ld, \"fusoes_evitadas\": %ld, \"pico_nos\": %ld, \"chamadas_evitadas\": %ld}\n",
+               r->politica, r->tam_mem, r->requisicoes, r->alocacoes, r->falhas, r->liberacoes,
+               r->livre_total, r->maior_livre, r->blocos_livres, r->nos, r->frag_interna, r->frag_externa,
+               r->coalescencias, r->compactacoes, r->falhas_evitadas, r->kb_movidos, r->ms_compactacao,
+               r->fusoes_adiadas, r->descarregamentos, r->divisoes_evitadas, r->fusoes_evitadas,
+               r->pico_nos, r->chamadas_evitadas);
+    } else {
+        printf("\n--- Resumo (%s, %" PRIu64 " KB) ---\n", r->politica, r->tam_mem);
+        printf("Requisicoes processadas: %ld\n", r->requisicoes);
+        printf("Alocacoes: %ld (falhas: %ld) | Liberacoes: %ld\n", r->alocacoes, r->falhas, r->liberacoes);
+        printf("Memoria livre: %" PRIu64 " KB em %d blocos (maior: %" PRIu64 " KB) | Nos na lista: %d\n",
+               r->livre_total, r->blocos_livres, r->maior_livre, r->nos);
+        printf("Fragmentacao externa: %.4f (1 - maior livre / total livre)\n", r->frag_externa);
+        if (strncmp(r->politica, "buddy", 5) == 0) {
+            printf("Fragmentacao interna total: %" PRIu64 " KB\n", r->frag_interna);
+        } else {
+            printf("Coalescencias realizadas: %ld\n", r->coalescencias);
+        }
+        if (r->compactacoes > 0) {
+            printf("Compactacoes: %ld (%ld falhas evitadas) | %" PRIu64 " KB movidos em %.3f ms\n",
+                   r->compactacoes, r->falhas_evitadas, r->kb_movidos, r->ms_compactacao);
+        }
+        if (r->fusoes_adiadas > 0) {
+            printf("Fusoes adiadas: %ld (%ld descarregamentos) | Evitadas em relacao a fusao imediata: "
+                   "%ld divisoes, %ld fusoes\n", r->fusoes_adiadas, r->descarregamentos,
+                   r->divisoes_evitadas, r->fusoes_evitadas);
+        }
+        if (r->pico_nos > 0) { // O buddy em árvore implícita não usa pool
+            printf("Pool de nos: pico de %ld nos, %ld chamadas ao alocador evitadas\n",
+                   r->pico_nos, r->chamadas_evitadas);
+        }
+    }
+}
+
+//------------ Nomes de processos -------------------
+// Cada nome lido do arquivo texto é internado uma vez e vira um ID de 32 bits (0, 1, 2, ... na ordem em que aparece).
+// As políticas só guardam e comparam o ID; o nome só é consultado para exibição.
+// Em traces binários os IDs já são numéricos e não há nomes: eles são exibidos em decimal.
+#define TAM_MAX_ID 63
+
+// Posição da tabela de nomes. Guardar o hash junto do ID deixa a sondagem descartar os outros nomes
+// sem ler os textos, e o crescimento reposiciona os IDs sem recalcular nenhum hash.
+typedef struct PosicaoNome {
+    uint32_t id;            // ID + 1 (0 = posição vazia)
+    uint32_t hash;
+} PosicaoNome;
+
+typedef struct TabelaNomes {
+    char *textos;           // Cada nome precedido do seu tamanho (1 byte) e terminado em '\0', um após o outro
+    size_t tam_textos;
+    size_t cap_textos;
+    size_t *inicio;         // Posição do nome de cada ID em textos (depois do byte de tamanho)
+    uint32_t qtd;
+    uint32_t cap;
+    PosicaoNome *posicoes;  // Endereçamento aberto
+    uint32_t cap_posicoes;  // Sempre potência de 2
+} TabelaNomes;
+
+TabelaNomes nomes_processos;
+
+void nomes_limpar() {
+    free(nomes_processos.textos);
+    free(nomes_processos.inicio);
+    free(nomes_processos.posicoes);
+    memset(&nomes_processos, 0, sizeof(TabelaNomes));
+}
+
+// Hash FNV-1a do nome
+uint32_t hash_nome(const char *nome, size_t tam) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < tam; i++) {
+        h ^= (unsigned char)nome[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void nomes_posicionar(PosicaoNome p) {
+    uint32_t mascara = nomes_processos.cap_posicoes - 1;
+    uint32_t i = p.hash & mascara;
+    while (nomes_processos.posicoes[i].id != 0) {
+        i = (i + 1) & mascara;
+    }
+    nomes_processos.posicoes[i] = p;
+}
+
+// Retorna o ID do nome [nome, nome + tam), criando um novo se o nome ainda não apareceu
+uint32_t internar_nome(const char *nome, size_t tam) {
+    TabelaNomes *t = &nomes_processos;
+    if ((t->qtd + 1) * 2 > t->cap_posicoes) {
+        // Mantém a carga abaixo de 50%
+        PosicaoNome *antigas = t->posicoes;
+        uint32_t cap_antiga = t->cap_posicoes;
+        t->cap_posicoes = t->cap_posicoes ? t->cap_posicoes * 2 : 1024;
+        t->posicoes = calloc(t->cap_posicoes, sizeof(PosicaoNome));
+        if (t->posicoes == NULL) {
+            perror("Erro ao alocar a tabela de nomes");
+            exit(EXIT_FAILURE);
+        }
+        for (uint32_t j = 0; j < cap_antiga; j++) {
+            if (antigas[j].id != 0) nomes_posicionar(antigas[j]);
+        }
+        free(antigas);
+    }
+
+    uint32_t hash = hash_nome(nome, tam);
+    uint32_t mascara = t->cap_posicoes - 1;
+    uint32_t i = hash & mascara;
+    while (t->posicoes[i].id != 0) {
+        if (t->posicoes[i].hash == hash) {
+            const char *existente = t->textos + t->inicio[t->posicoes[i].id - 1];
+            if ((unsigned char)existente[-1] == tam && memcmp(existente, nome, tam) == 0) {
+                return t->posicoes[i].id - 1;
+            }
+        }
+        i = (i + 1) & mascara;
+    }
+
+    if (t->qtd == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->inicio = realloc(t->inicio, t->cap * sizeof(size_t));
+    }
+    while (t->tam_textos + tam + 2 > t->cap_textos) {
+        t->cap_textos = t->cap_textos ? t->cap_textos * 2 : 1 << 14;
+        t->textos = realloc(t->textos, t->cap_textos);
+    }
+    if (t->inicio == NULL || t->textos == NULL) {
+        perror("Erro ao alocar a tabela de nomes");
+        exit(EXIT_FAILURE);
+    }
+    t->textos[t->tam_textos] = (char)tam; // TAM_MAX_ID cabe em um byte
+    memcpy(t->textos + t->tam_textos + 1, nome, tam);
+    t->textos[t->tam_textos + 1 + tam] = '\0';
+    t->inicio[t->qtd] = t->tam_textos + 1;
+    t->tam_textos += tam + 2;
+    t->posicoes[i] = (PosicaoNome){t->qtd + 1, hash};
+    return t->qtd++;
+}
+
+// Nome de exibição do processo. IDs sem nome (traces binários) são mostrados em decimal.
+const char* nome_processo(uint32_t id) {
+    static char buffers[2][16]; // Dois para permitir dois nomes no mesmo printf
+    static int atual = 0;
+    if (id < nomes_processos.qtd) {
+        return nomes_processos.textos + nomes_processos.inicio[id];
+    }
+    atual ^= 1;
+    snprintf(buffers[atual], sizeof(buffers[atual]), "%u", id);
+    return buffers[atual];
+}
+
+//------------ Leitura das requisicoes -------------------
+// O arquivo é lido em lotes para um vetor compacto de requisições, compartilhado pelas três políticas.
+// Texto (IN(ID,TAM)/OUT(ID)) é mapeado em memória e lido por um analisador feito à mão;
+// o formato binário (registros de tamanho fixo) é lido em blocos, sem carregar o arquivo inteiro.
+#define REQ_IN 0
+#define REQ_OUT 1
+#define LOTE_REQUISICOES 65536  // Requisições por lote entregue à política
+
+typedef struct Requisicao {
+    uint32_t id;            // ID do processo (nome internado)
+    uint8_t op;             // REQ_IN ou REQ_OUT
+    uint64_t tam;           // Só em REQ_IN (KB)
+} Requisicao;
+
+// Executa uma requisição na política escolhida; contexto é a instância que a recebe
+typedef void (*ExecutarRequisicao)(void *contexto, Requisicao *req);
+
+typedef struct ListaRequisicoes {
+    Requisicao *itens;
+    long qtd;
+    long linhas_invalidas;
+    ExecutarRequisicao executar;
+    void *contexto;
+} ListaRequisicoes;
+
+// Formato binário: cabeçalho seguido de registros de 16 bytes na ordem do arquivo texto.
+// Os campos ficam na ordem de bytes da máquina que converteu o arquivo.
+#define MAGICA_BINARIO "TP2B"
+#define VERSAO_BINARIO 1
+#define MAIOR_ID_BINARIO (UINT32_MAX - 2) // Os dois IDs acima marcam blocos livres e slabs (ID_LIVRE, ID_SLAB)
+
+typedef struct CabecalhoBinario {
+    char magica[4];
+    uint32_t versao;
+    uint64_t qtd_registros;     // 0 se desconhecido
+} CabecalhoBinario;
+
+typedef struct RegistroBinario {
+    uint8_t op;                 // REQ_IN ou REQ_OUT
+    uint8_t reservado[3];
+    uint32_t id;                // ID numérico do processo
+    uint64_t tam;               // Só em REQ_IN
+} RegistroBinario;
+
+// Entrega o lote atual à política e esvazia o vetor
+void lista_descarregar(ListaRequisicoes *lista) {
+    for (long i = 0; i < lista->qtd; i++) {
+        lista->executar(lista->contexto, &lista->itens[i]);
+    }
+    lista->qtd = 0;
+}
+
+void lista_adicionar(ListaRequisicoes *lista, const Requisicao *r) {
+    if (lista->qtd == LOTE_REQUISICOES) {
+        lista_descarregar(lista);
+    }
+    lista->itens[lista->qtd++] = *r;
+}
+
+// Lê uma linha IN(ID,TAM) ou OUT(ID) em [p, fim). Espaços entre os tokens são aceitos.
+// Retorna false se a linha não segue o formato.
+bool analisar_linha(const char *p, const char *fim, Requisicao *r) {
+    #define PULA_ESPACOS() while (p < fim && (*p == ' ' || *p == '\t')) p++
+
+    PULA_ESPACOS();
+    if (fim - p >= 3 && p[0] == 'I' && p[1] == 'N' && p[2] == '(') {
+        r->op = REQ_IN;
+        p += 3;
+    } else if (fim - p >= 4 && p[0] == 'O' && p[1] == 'U' && p[2] == 'T' && p[3] == '(') {
+        r->op = REQ_OUT;
+        p += 4;
+    } else {
+        return false;
+    }
+
+    PULA_ESPACOS();
+    const char *nome = p;
+    while (p < fim && *p != ',' && *p != ')' && *p != ' ' && *p != '\t') p++;
+    size_t tam_nome = p - nome;
+    if (tam_nome == 0 || tam_nome > TAM_MAX_ID) return false;
+    PULA_ESPACOS();
+
+    if (r->op == REQ_IN) {
+        if (p == fim || *p != ',') return false;
+        p++;
+        PULA_ESPACOS();
+        if (p == fim || *p < '0' || *p > '9') return false;
+        uint64_t tam = 0;
+        while (p < fim && *p >= '0' && *p <= '9') {
+            unsigned digito = *p++ - '0';
+            if (tam > (UINT64_MAX - digito) / 10) return false;
+            tam = tam * 10 + digito;
+        }
+        if (tam == 0) return false; // Um bloco vazio teria o mesmo endereço do seguinte
+        r->tam = tam;
+        PULA_ESPACOS();
+    } else {
+        r->tam = 0;
+    }
+
+    if (p == fim || *p != ')') return false;
+    p++;
+    PULA_ESPACOS();
+    if (p != fim) return false;
+
+    r->id = internar_nome(nome, tam_nome); // Só linhas válidas criam nomes
+    return true;
+    #undef PULA_ESPACOS
+}
+
+// Separa o texto em linhas e acrescenta as requisições válidas à lista.
+// Linhas inválidas são informadas com o número da linha; linhas vazias são ignoradas.
+void analisar_requisicoes(const char *texto, size_t tam, ListaRequisicoes *lista) {
+    const char *p = texto;
+    const char *fim_texto = texto + tam;
+    long num_linha = 0;
+
+    while (p < fim_texto) {
+        const char *fim_linha = memchr(p, '\n', fim_texto - p);
+        if (fim_linha == NULL) fim_linha = fim_texto;
+        num_linha++;
+
+        const char *fim = fim_linha;
+        if (fim > p && fim[-1] == '\r') fim--; // Arquivos com quebra de linha do Windows
+
+        Requisicao r;
+        if (analisar_linha(p, fim, &r)) {
+            lista_adicionar(lista, &r);
+        } else {
+            const char *q = p;
+            while (q < fim && (*q == ' ' || *q == '\t')) q++;
+            if (q < fim) {
+                fprintf(stderr, "Linha %ld invalida no arquivo: %.*s\n", num_linha, (int)(fim - p), p);
+                lista->linhas_invalidas++;
+            }
+        }
+        p = fim_linha + 1;
+    }
+}
+
+// Converte um registro binário; o ID é usado diretamente, exceto os reservados
+bool converter_registro(const RegistroBinario *reg, long num, Requisicao *r) {
+    if ((reg->op != REQ_IN && reg->op != REQ_OUT) || (reg->op == REQ_IN && reg->tam == 0)
+        || reg->id > MAIOR_ID_BINARIO) {
+        fprintf(stderr, "Registro %ld invalido no arquivo (op %u, ID %u, tamanho %llu)\n",
+                num, reg->op, reg->id, (unsigned long long)reg->tam);
+        return false;
+    }
+    r->id = reg->id;
+    r->op = reg->op;
+    r->tam = reg->tam;
+    return true;
+}
+
+// Lê exatamente tam bytes (menos só no fim do arquivo). Retorna quantos foram lidos.
+size_t ler_tudo(int fd, void *destino, size_t tam) {
+    size_t total = 0;
+    ssize_t lidos;
+    while (total < tam && (lidos = read(fd, (char *)destino + total, tam - total)) > 0) {
+        total += lidos;
+    }
+    return total;
+}
+
+// Replay do formato binário: lê os registros em blocos, sem carregar o arquivo inteiro
+void processar_binario(int fd, ListaRequisicoes *lista) {
+    RegistroBinario *bloco = malloc(LOTE_REQUISICOES * sizeof(RegistroBinario));
+    if (bloco == NULL) {
+        perror("Erro ao alocar o bloco de leitura");
+        exit(EXIT_FAILURE);
+    }
+    long num = 0;
+    size_t lidos;
+    while ((lidos = ler_tudo(fd, bloco, LOTE_REQUISICOES * sizeof(RegistroBinario))) > 0) {
+        size_t qtd = lidos / sizeof(RegistroBinario);
+        for (size_t i = 0; i < qtd; i++) {
+            Requisicao r;
+            if (converter_registro(&bloco[i], ++num, &r)) {
+                lista_adicionar(lista, &r);
+            } else {
+                lista->linhas_invalidas++;
+            }
+        }
+        if (lidos % sizeof(RegistroBinario) != 0) {
+            fprintf(stderr, "Arquivo binario truncado apos o registro %ld\n", num);
+            break;
+        }
+    }
+    free(bloco);
+}
+
+bool eh_cabecalho_binario(const char *dados, size_t tam) {
+    return tam >= sizeof(CabecalhoBinario) && memcmp(dados, MAGICA_BINARIO, 4) == 0;
+}
+
+// Lê as requisições do arquivo ("-" é a entrada padrão) e as entrega, em lotes, a executar(contexto, ...).
+// A tabela de nomes é recomeçada a cada arquivo.
+// O formato (texto ou binário) é detectado pelo cabeçalho. Arquivos texto regulares são mapeados
+// com mmap; texto vindo de pipe é lido para um buffer. Retorna 0, ou -1 se o arquivo não pôde ser lido.
+int processar_requisicoes(const char *nome_arquivo, ExecutarRequisicao executar, void *contexto) {
+    int fd = strcmp(nome_arquivo, "-") == 0 ? STDIN_FILENO : open(nome_arquivo, O_RDONLY);
+    if (fd < 0) {
+        perror("Erro ao abrir o arquivo de requisicoes");
+        return -1;
+    }
+
+    nomes_limpar();
+    ListaRequisicoes lista;
+    memset(&lista, 0, sizeof(ListaRequisicoes));
+    lista.executar = executar;
+    lista.contexto = contexto;
+    lista.itens = malloc(LOTE_REQUISICOES * sizeof(Requisicao));
+    if (lista.itens == NULL) {
+        perror("Erro ao alocar o vetor de requisicoes");
+        exit(EXIT_FAILURE);
+    }
+
+    CabecalhoBinario cab;
+    size_t tam_cab = ler_tudo(fd, &cab, sizeof(cab));
+
+    struct stat info;
+    if (eh_cabecalho_binario((char *)&cab, tam_cab)) {
+        processar_binario(fd, &lista);
+    } else if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size > 0) {
+            char *texto = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (texto == MAP_FAILED) {
+                perror("Erro ao mapear o arquivo de requisicoes");
+                free(lista.itens);
+                if (fd != STDIN_FILENO) close(fd);
+                return -1;
+            }
+            madvise(texto, info.st_size, MADV_SEQUENTIAL);
+            analisar_requisicoes(texto, info.st_size, &lista);
+            munmap(texto, info.st_size);
+        }
+    } else {
+        // Texto vindo de pipe ou terminal: não dá para mapear, lê tudo para um buffer
+        size_t tam = tam_cab, cap = 1 << 16;
+        char *texto = malloc(cap);
+        if (texto != NULL) memcpy(texto, &cab, tam_cab);
+        ssize_t lidos;
+        while (texto != NULL && (lidos = read(fd, texto + tam, cap - tam)) > 0) {
+            tam += lidos;
+            if (tam == cap) {
+                cap *= 2;
+                texto = realloc(texto, cap);
+            }
+        }
+        if (texto == NULL) {
+            perror("Erro ao ler o arquivo de requisicoes");
+            exit(EXIT_FAILURE);
+        }
+        analisar_requisicoes(texto, tam, &lista);
+        free(texto);
+    }
+
+    lista_descarregar(&lista);
+    free(lista.itens);
+    if (fd != STDIN_FILENO) close(fd);
+    return 0;
+}
+
+// ---- Série temporal ----
+// Uma amostra compacta da ocupação a cada N requisições, em CSV ou binário, para acompanhar
+// como cada política se degrada ao longo de um trace longo sem passar pelos dumps em texto.
+#define SERIE_CSV 0
+#define SERIE_BINARIA 1
+#define MAGICA_SERIE "TP2S"
+#define VERSAO_SERIE 1
+
+FILE *saida_serie = NULL;           // NULL = série desligada
+int formato_serie = SERIE_CSV;
+long intervalo_serie = 1;           // Grava uma amostra a cada N requisições
+
+typedef struct CabecalhoSerie {
+    char magica[4];
+    uint32_t versao;
+    uint64_t tam_mem;           // KB
+    uint64_t intervalo;
+} CabecalhoSerie;
+
+// Registro de 48 bytes, na ordem de bytes da máquina; tamanhos em KB
+typedef struct AmostraSerie {
+    uint64_t requisicao;        // Requisições processadas até aqui
+    uint64_t livre;
+    uint64_t maior_livre;
+    uint64_t frag_interna;
+    uint64_t falhas;            // INs recusados até aqui
+    uint32_t blocos_livres;
+    uint8_t politica;           // POLITICA_*
+    uint8_t reservado[3];
+} AmostraSerie;
+
+// Lê a ocupação atual da instância (contexto) em O(1)
+typedef void (*LerFragmentacao)(void *contexto, Fragmentacao *f);
+
+//------------ Instantaneos -------------------
+// Estado completo de uma instância, gravado após a requisição N (--snapshot) e mapeado de volta com mmap
+// (--restaurar) para retomar a simulação sem refazer o aquecimento. O arquivo é o cabeçalho seguido de três
+// vetores de registros de tamanho fixo: os blocos em ordem de endereço, os endereços dos blocos livres na
+// ordem das estruturas de livres da política e as entradas do índice de processos, cada uma na sua posição
+// da tabela (assim IDs repetidos continuam sendo liberados na mesma ordem).
+#define MAGICA_INSTANTANEO "TP2R"
+#define VERSAO_INSTANTANEO 1
+
+const char *arquivo_instantaneo = NULL; // --snapshot
+long instantaneo_em = 0;                // --snapshot-em: requisições processadas antes da gravação
+const char *arquivo_restaurar = NULL;   // --restaurar
+
+typedef struct CabecalhoInstantaneo {
+    char magica[4];
+    uint32_t versao;
+    int32_t politica;           // POLITICA_*
+    int32_t ordem_minima;       // Buddy
+    uint64_t tam_mem;           // KB
+    uint64_t requisicoes;       // Requisições já refletidas no estado
+    uint64_t alocacoes;
+    uint64_t falhas;
+    uint64_t liberacoes;
+    uint64_t totais[6];         // Totais próprios da política (coalescências, compactação, divisões, fusões)
+                                // e, no Circular-Fit, o endereço de pos_busca
+    uint64_t qtd_blocos;
+    uint64_t qtd_livres;
+    uint64_t cap_indice;
+    uint64_t qtd_indice;
+} CabecalhoInstantaneo;
+
+// Registro de 32 bytes, na ordem de bytes da máquina; tamanhos em KB
+typedef struct RegistroBloco {
+    uint64_t inicio;
+    uint64_t tam;
+    uint64_t tam_pedido;        // Só no Buddy
+    uint32_t pid;
+    uint8_t alocado;
+    uint8_t adiado;             // Buddy: fusão pendente
+    char lado;                  // Buddy: 'L', 'R' ou '-'
+    uint8_t reservado;
+} RegistroBloco;
+
+typedef struct RegistroIndice {
+    uint32_t posicao;           // Posição na tabela
+    uint32_t chave;
+    uint64_t inicio;            // Bloco do processo, pelo endereço
+} RegistroIndice;
+
+typedef struct Instantaneo {
+    CabecalhoInstantaneo cab;
+    RegistroBloco *blocos;
+    uint64_t *livres;
+    RegistroIndice *indice;
+} Instantaneo;
+
+// Cada política preenche o instantâneo a partir da instância (contexto) e reconstrói a instância a partir dele
+typedef void (*CapturarEstado)(void *contexto, Instantaneo *s);
+typedef bool (*RestaurarEstado)(void *contexto, const Instantaneo *s);
+
+typedef struct OperacoesEstado {
+    CapturarEstado capturar;
+    RestaurarEstado restaurar;
+} OperacoesEstado;
+
+void instantaneo_reservar(Instantaneo *s, uint64_t blocos, uint64_t livres, uint64_t indice) {
+    s->cab.qtd_blocos = blocos;
+    s->cab.qtd_livres = livres;
+    s->cab.qtd_indice = indice;
+    s->blocos = calloc(blocos ? blocos : 1, sizeof(RegistroBloco));
+    s->livres = malloc((livres ? livres : 1) * sizeof(uint64_t));
+    s->indice = malloc((indice ? indice : 1) * sizeof(RegistroIndice));
+    if (s->blocos == NULL || s->livres == NULL || s->indice == NULL) {
+        perror("Erro ao alocar o instantaneo");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void instantaneo_contadores(Instantaneo *s, const Contadores *c) {
+    s->cab.requisicoes = c->requisicoes;
+    s->cab.alocacoes = c->alocacoes;
+    s->cab.falhas = c->falhas;
+    s->cab.liberacoes = c->liberacoes;
+}
+
+void restaurar_contadores(Contadores *c, const Instantaneo *s) {
+    c->requisicoes = s->cab.requisicoes;
+    c->alocacoes = s->cab.alocacoes;
+    c->falhas = s->cab.falhas;
+    c->liberacoes = s->cab.liberacoes;
+}
+
+// Posição do registro do bloco que começa em inicio (os blocos estão em ordem de endereço), ou -1
+long registro_do_endereco(const Instantaneo *s, uint64_t inicio) {
+    long esq = 0, dir = (long)s->cab.qtd_blocos - 1;
+    while (esq <= dir) {
+        long meio = esq + (dir - esq) / 2;
+        if (s->blocos[meio].inicio == inicio) return meio;
+        if (s->blocos[meio].inicio < inicio) esq = meio + 1;
+        else dir = meio - 1;
+    }
+    return -1;
+}
+
+// Os blocos precisam ser contíguos e cobrir a memória inteira, e cada livre e cada entrada do índice precisam
+// apontar para um bloco livre ou alocado. Vale tanto para o que é gravado quanto para o que é restaurado.
+bool validar_instantaneo(const Instantaneo *s) {
+    uint64_t fim = 0;
+    for (uint64_t i = 0; i < s->cab.qtd_blocos; i++) {
+        if (s->blocos[i].inicio != fim || s->blocos[i].tam == 0) return false;
+        fim += s->blocos[i].tam;
+    }
+    if (s->cab.qtd_blocos == 0 || fim != s->cab.tam_mem) return false;
+    for (uint64_t j = 0; j < s->cab.qtd_livres; j++) {
+        long i = registro_do_endereco(s, s->livres[j]);
+        if (i < 0 || s->blocos[i].alocado) return false;
+    }
+    for (uint64_t j = 0; j < s->cab.qtd_indice; j++) {
+        long i = registro_do_endereco(s, s->indice[j].inicio);
+        if (i < 0 || !s->blocos[i].alocado) return false;
+    }
+    return true;
+}
+
+// Grava o instantâneo capturado e libera os seus vetores. Um estado que o carregador recusaria não é gravado.
+bool gravar_instantaneo(const char *nome, Instantaneo *s) {
+    if (!validar_instantaneo(s)) {
+        fprintf(stderr, "Estado sem instantaneo valido; %s nao foi gravado\n", nome);
+        free(s->blocos);
+        free(s->livres);
+        free(s->indice);
+        return false;
+    }
+    memcpy(s->cab.magica, MAGICA_INSTANTANEO, 4);
+    s->cab.versao = VERSAO_INSTANTANEO;
+    FILE *f = fopen(nome, "wb");
+    bool ok = f != NULL
+              && fwrite(&s->cab, sizeof(s->cab), 1, f) == 1
+              && fwrite(s->blocos, sizeof(RegistroBloco), s->cab.qtd_blocos, f) == s->cab.qtd_blocos
+              && fwrite(s->livres, sizeof(uint64_t), s->cab.qtd_livres, f) == s->cab.qtd_livres
+              && fwrite(s->indice, sizeof(RegistroIndice), s->cab.qtd_indice, f) == s->cab.qtd_indice;
+    if (f != NULL && fclose(f) != 0) ok = false;
+    if (!ok) perror("Erro ao gravar o instantaneo");
+    free(s->blocos);
+    free(s->livres);
+    free(s->indice);
+    return ok;
+}
+
+// Mapeia o arquivo e aponta os vetores do instantâneo para dentro do mapeamento, sem copiar.
+// Retorna o mapeamento (para o munmap) ou NULL se o arquivo não é um instantâneo válido.
+void* mapear_instantaneo(const char *nome, Instantaneo *s, size_t *tam) {
+    int fd = open(nome, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror("Erro ao abrir o instantaneo");
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    *tam = info.st_size;
+    char *mapa = *tam >= sizeof(CabecalhoInstantaneo) ? mmap(NULL, *tam, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        fprintf(stderr, "Instantaneo invalido: %s\n", nome);
+        return NULL;
+    }
+    memcpy(&s->cab, mapa, sizeof(s->cab));
+    const CabecalhoInstantaneo *c = &s->cab;
+    uint64_t limite = *tam / sizeof(RegistroIndice); // Nenhum vetor tem mais registros que isso
+    if (memcmp(c->magica, MAGICA_INSTANTANEO, 4) != 0 || c->versao != VERSAO_INSTANTANEO
+        || c->qtd_blocos > limite || c->qtd_livres > limite || c->qtd_indice > limite
+        || sizeof(CabecalhoInstantaneo) + c->qtd_blocos * sizeof(RegistroBloco) + c->qtd_livres * sizeof(uint64_t)
+           + c->qtd_indice * sizeof(RegistroIndice) != *tam) {
+        fprintf(stderr, "Instantaneo invalido: %s\n", nome);
+        munmap(mapa, *tam);
+        return NULL;
+    }
+    s->blocos = (RegistroBloco *)(mapa + sizeof(CabecalhoInstantaneo));
+    s->livres = (uint64_t *)(s->blocos + c->qtd_blocos);
+    s->indice = (RegistroIndice *)(s->livres + c->qtd_livres);
+    return mapa;
+}
+
+// Carrega --restaurar na instância. Retorna as requisições já refletidas no estado, ou -1 em erro.
+long restaurar_instantaneo(const OperacoesEstado *estado, void *contexto, int politica, uint64_t tam_mem) {
+    if (estado == NULL) {
+        fprintf(stderr, "Esta politica nao tem instantaneos\n");
+        return -1;
+    }
+    Instantaneo s;
+    size_t tam;
+    void *mapa = mapear_instantaneo(arquivo_restaurar, &s, &tam);
+    if (mapa == NULL) return -1;
+    long requisicoes = -1;
+    if (s.cab.politica != politica || s.cab.tam_mem != tam_mem) {
+        fprintf(stderr, "O instantaneo e de outra configuracao (politica %d, %" PRIu64 " KB)\n",
+                s.cab.politica, s.cab.tam_mem);
+    } else if (!validar_instantaneo(&s) || !estado->restaurar(contexto, &s)) {
+        fprintf(stderr, "Instantaneo invalido: %s\n", arquivo_restaurar);
+    } else {
+        requisicoes = (long)s.cab.requisicoes;
+        LOG("Estado restaurado apos %ld requisicoes.\n", requisicoes);
+    }
+    munmap(mapa, tam);
+    return requisicoes;
+}
+
+typedef struct Serie {
+    ExecutarRequisicao executar;    // Política envolvida
+    void *contexto;
+    LerFragmentacao ler;
+    const Contadores *cont;
+    const char *nome_politica;
+    int politica;
+    long requisicoes;
+    long ultima_gravada;
+    const OperacoesEstado *estado;
+    long pular;                     // Requisições do início da entrada já refletidas no estado restaurado
+    bool instantaneo_gravado;
+} Serie;
+
+void serie_gravar(Serie *s) {
+    Fragmentacao f;
+    s->ler(s->contexto, &f);
+    if (formato_serie == SERIE_BINARIA) {
+        AmostraSerie a;
+        memset(&a, 0, sizeof(a));
+        a.requisicao = s->requisicoes;
+        a.livre = f.livre;
+        a.maior_livre = f.maior_livre;
+        a.frag_interna = f.frag_interna;
+        a.falhas = s->cont->falhas;
+        a.blocos_livres = f.blocos_livres;
+        a.politica = s->politica;
+        fwrite(&a, sizeof(a), 1, saida_serie);
+    } else {
+        fprintf(saida_serie, "%ld,%s,%" PRIu64 ",%" PRIu64 ",%d,%" PRIu64 ",%ld\n", s->requisicoes, s->nome_politica,
+                f.livre, f.maior_livre, f.blocos_livres, f.frag_interna, s->cont->falhas);
+    }
+    s->ultima_gravada = s->requisicoes;
+}
+
+void executar_com_serie(void *contexto, Requisicao *req) {
+    Serie *s = contexto;
+    if (s->pular > 0) {
+        s->pular--; // Os nomes continuam sendo internados na mesma ordem, então os IDs batem com o instantâneo
+        return;
+    }
+    s->executar(s->contexto, req);
+    s->requisicoes++;
+    if (saida_serie != NULL && s->requisicoes % intervalo_serie == 0) serie_gravar(s);
+    if (arquivo_instantaneo != NULL && s->requisicoes == instantaneo_em && s->estado != NULL) {
+        Instantaneo inst;
+        memset(&inst, 0, sizeof(inst));
+        inst.cab.politica = s->politica;
+        s->estado->capturar(s->contexto, &inst);
+        s->instantaneo_gravado = gravar_instantaneo(arquivo_instantaneo, &inst);
+    }
+}
+
+// processar_requisicoes que também grava a série da instância (--serie), grava o instantâneo (--snapshot)
+// e começa de um instantâneo (--restaurar). estado são as operações de instantâneo da política (ou NULL).
+int processar_com_serie(const char *nome_arquivo, ExecutarRequisicao executar, void *contexto, LerFragmentacao ler,
+                        const Contadores *cont, int politica, const char *nome_politica, uint64_t tam_mem,
+                        const OperacoesEstado *estado) {
+    Serie s;
+    memset(&s, 0, sizeof(s));
+    if (arquivo_restaurar != NULL) {
+        s.pular = restaurar_instantaneo(estado, contexto, politica, tam_mem);
+        if (s.pular < 0) return -1;
+    }
+    if (saida_serie == NULL && arquivo_instantaneo == NULL && s.pular == 0) {
+        return processar_requisicoes(nome_arquivo, executar, contexto);
+    }
+
+    s.executar = executar;
+    s.contexto = contexto;
+    s.ler = ler;
+    s.cont = cont;
+    s.politica = politica;
+    s.nome_politica = nome_politica;
+    s.estado = estado;
+    s.requisicoes = s.ultima_gravada = s.pular;
+    long restauradas = s.pular;
+    if (saida_serie != NULL && formato_serie == SERIE_BINARIA) {
+        CabecalhoSerie cab;
+        memset(&cab, 0, sizeof(cab));
+        memcpy(cab.magica, MAGICA_SERIE, 4);
+        cab.versao = VERSAO_SERIE;
+        cab.tam_mem = tam_mem;
+        cab.intervalo = intervalo_serie;
+        fwrite(&cab, sizeof(cab), 1, saida_serie);
+    } else if (saida_serie != NULL) {
+        fprintf(saida_serie, "requisicao,politica,livre_kb,maior_livre_kb,blocos_livres,frag_interna_kb,falhas\n");
+    }
+
+    int status = processar_requisicoes(nome_arquivo, executar_com_serie, &s);
+    if (status == 0 && s.pular > 0) {
+        fprintf(stderr, "A entrada tem menos requisicoes que o instantaneo\n");
+        return -1;
+    }
+    if (status == 0 && arquivo_instantaneo != NULL && !s.instantaneo_gravado) {
+        if (instantaneo_em <= restauradas) {
+            fprintf(stderr, "Instantaneo nao gravado: o estado restaurado ja tem %ld requisicoes\n", restauradas);
+        } else if (s.requisicoes < instantaneo_em) {
+            fprintf(stderr, "Instantaneo nao gravado: a entrada tem so %ld requisicoes\n", s.requisicoes);
+        }
+        status = -1; // A falha na gravação já foi informada por gravar_instantaneo
+    }
+    if (saida_serie != NULL) {
+        if (s.ultima_gravada != s.requisicoes) serie_gravar(&s); // O estado final sempre aparece
+        fflush(saida_serie);
+    }
+    return status;
+}
+
+//------------ Indice de processos (hash) -------------------
+// Tabela de endereçamento aberto (sondagem linear) do ID do processo para o seu bloco,
+// compartilhada pelas três políticas: um OUT encontra o bloco sem percorrer a lista.
+// Um ID com vários blocos vivos tem uma entrada por bloco, e o OUT libera o mais antigo deles:
+// entradas da mesma chave ficam na ordem de sondagem em que foram inseridas, e nem a remoção
+// (que só desloca entradas para trás) nem o crescimento da tabela trocam essa ordem.
+typedef struct EntradaPid {
+    uint32_t chave;     // ID do processo
+    void *valor;        // Bloco/BlockBuddy do processo (NULL = posição vazia)
+} EntradaPid;
+
+typedef struct TabelaPid {
+    EntradaPid *entradas;
+    int capacidade;     // Sempre potência de 2
+    int ocupadas;
+} TabelaPid;
+
+// Hash multiplicativo do ID (IDs internados são sequenciais)
+unsigned int hash_pid(uint32_t chave) {
+    uint32_t h = chave * 2654435769u;
+    return h ^ (h >> 16);
+}
+
+void tabela_iniciar(TabelaPid *t, int capacidade) {
+    t->entradas = calloc(capacidade, sizeof(EntradaPid));
+    if (t->entradas == NULL) {
+        perror("Erro ao alocar o indice de processos");
+        exit(EXIT_FAILURE);
+    }
+    t->capacidade = capacidade;
+    t->ocupadas = 0;
+}
+
+void tabela_limpar(TabelaPid *t) {
+    free(t->entradas);
+    t->entradas = NULL;
+    t->capacidade = 0;
+    t->ocupadas = 0;
+}
+
+void tabela_inserir(TabelaPid *t, uint32_t chave, void *valor);
+
+// Dobra a capacidade e reinsere as entradas. A reinserção começa logo após uma posição vazia, para que
+// um agrupamento que dá a volta no fim da tabela seja relido na ordem de sondagem e não pela metade final.
+void tabela_crescer(TabelaPid *t) {
+    EntradaPid *antigas = t->entradas;
+    int cap_antiga = t->capacidade;
+    int inicio = 0;
+    while (antigas[inicio].valor != NULL) inicio++; // A carga abaixo de 50% garante uma posição vazia
+
+    tabela_iniciar(t, cap_antiga * 2);
+    for (int n = 1; n <= cap_antiga; n++) {
+        int i = (inicio + n) & (cap_antiga - 1);
+        if (antigas[i].valor != NULL) {
+            tabela_inserir(t, antigas[i].chave, antigas[i].valor);
+        }
+    }
+    free(antigas);
+}
+
+// Insere o par (ID, bloco). IDs repetidos ganham entradas separadas.
+void tabela_inserir(TabelaPid *t, uint32_t chave, void *valor) {
+    if ((t->ocupadas + 1) * 2 > t->capacidade) {
+        tabela_crescer(t); // Mantém a carga abaixo de 50%
+    }
+    unsigned int mascara = t->capacidade - 1;
+    unsigned int i = hash_pid(chave) & mascara;
+    while (t->entradas[i].valor != NULL) {
+        i = (i + 1) & mascara;
+    }
+    t->entradas[i].chave = chave;
+    t->entradas[i].valor = valor;
+    t->ocupadas++;
+}
+
+// Retorna o bloco de um processo (o mais antigo, se o ID tem vários), ou NULL se o ID não está na tabela
+void* tabela_buscar(TabelaPid *t, uint32_t chave) {
+    if (t->capacidade == 0) return NULL;
+    unsigned int mascara = t->capacidade - 1;
+    unsigned int i = hash_pid(chave) & mascara;
+    while (t->entradas[i].valor != NULL) {
+        if (t->entradas[i].chave == chave) {
+            return t->entradas[i].valor;
+        }
+        i = (i + 1) & mascara;
+    }
+    return NULL;
+}
+
+// Remove o par (ID, bloco) deslocando para trás as entradas seguintes (sem lápides)
+void tabela_remover(TabelaPid *t, uint32_t chave, void *valor) {
+    if (t->capacidade == 0) return;
+    unsigned int mascara = t->capacidade - 1;
+    unsigned int i = hash_pid(chave) & mascara;
+    while (t->entradas[i].valor != NULL &&
+           !(t->entradas[i].valor == valor && t->entradas[i].chave == chave)) {
+        i = (i + 1) & mascara;
+    }
+    if (t->entradas[i].valor == NULL) return;
+
+    unsigned int vazio = i;
+    unsigned int j = i;
+    while (1) {
+        j = (j + 1) & mascara;
+        if (t->entradas[j].valor == NULL) break;
+        unsigned int ideal = hash_pid(t->entradas[j].chave) & mascara;
+        // A entrada j pode ocupar o buraco se sua posição ideal não está entre (vazio, j]
+        if (((j - ideal) & mascara) >= ((j - vazio) & mascara)) {
+            t->entradas[vazio] = t->entradas[j];
+            vazio = j;
+        }
+    }
+    t->entradas[vazio].valor = NULL;
+    t->ocupadas--;
+}
+
+// Entradas ocupadas do índice; campo_inicio é o deslocamento do endereço inicial dentro do nó da política
+void capturar_indice(Instantaneo *s, const TabelaPid *t, size_t campo_inicio) {
+    uint64_t n = 0;
+    s->cab.cap_indice = t->capacidade;
+    for (int i = 0; i < t->capacidade; i++) {
+        if (t->entradas[i].valor == NULL) continue;
+        s->indice[n].posicao = i;
+        s->indice[n].chave = t->entradas[i].chave;
+        memcpy(&s->indice[n].inicio, (char *)t->entradas[i].valor + campo_inicio, sizeof(uint64_t));
+        n++;
+    }
+}
+
+// Recria o índice com a mesma capacidade e cada entrada na mesma posição; nos[i] é o nó do registro i
+bool restaurar_indice(TabelaPid *t, const Instantaneo *s, void **nos) {
+    uint64_t cap = s->cab.cap_indice;
+    if (cap == 0 || (cap & (cap - 1)) != 0 || cap > INT_MAX || s->cab.qtd_indice * 2 > cap) return false;
+    tabela_iniciar(t, (int)cap);
+    for (uint64_t i = 0; i < s->cab.qtd_indice; i++) {
+        const RegistroIndice *r = &s->indice[i];
+        long b = registro_do_endereco(s, r->inicio);
+        if (r->posicao >= cap || b < 0 || !s->blocos[b].alocado || t->entradas[r->posicao].valor != NULL) return false;
+        t->entradas[r->posicao].chave = r->chave;
+        t->entradas[r->posicao].valor = nos[b];
+        t->ocupadas++;
+    }
+    return true;
+}
+
+//------------ Pool de nos -------------------
+// Alocador de nós de tamanho fixo (Bloco e BlockBuddy): pede ao malloc blocos grandes com vários nós,
+// reaproveita nós liberados por uma lista livre intrusiva e devolve tudo de uma vez no reset.
+#define NOS_POR_BLOCO_POOL 1024
+
+typedef struct PoolNos {
+    size_t tam_no;      // Tamanho de cada nó
+    void *livres;       // Lista livre: os primeiros bytes de um nó livre apontam para o próximo
+    void **blocos;      // Blocos obtidos com malloc
+    int qtd_blocos;
+    int cap_blocos;
+    char *proximo;      // Próximo nó nunca usado do bloco atual
+    int restantes;      // Nós ainda não usados no bloco atual
+    long em_uso;        // Nós entregues e ainda não devolvidos
+    long pico;          // Maior valor de em_uso
+    long pedidos;       // Alocações + liberações atendidas pelo pool
+    long chamadas;      // Chamadas reais ao malloc/free feitas pelo pool
+} PoolNos;
+
+void pool_iniciar(PoolNos *p, size_t tam_no) {
+    memset(p, 0, sizeof(PoolNos));
+    p->tam_no = tam_no < sizeof(void *) ? sizeof(void *) : tam_no;
+}
+
+void* pool_alocar(PoolNos *p) {
+    void *no;
+    if (p->livres != NULL) {
+        no = p->livres;
+        p->livres = *(void **)no;
+    } else {
+        if (p->restantes == 0) {
+            if (p->qtd_blocos == p->cap_blocos) {
+                p->cap_blocos = p->cap_blocos ? p->cap_blocos * 2 : 16;
+                p->blocos = realloc(p->blocos, p->cap_blocos * sizeof(void *));
+            }
+            char *bloco = malloc(p->tam_no * NOS_POR_BLOCO_POOL);
+            if (p->blocos == NULL || bloco == NULL) {
+                perror("Erro ao alocar memoria para o pool de nos");
+                exit(EXIT_FAILURE);
+            }
+            p->blocos[p->qtd_blocos++] = bloco;
+            p->chamadas++;
+            p->proximo = bloco;
+            p->restantes = NOS_POR_BLOCO_POOL;
+        }
+        no = p->proximo;
+        p->proximo += p->tam_no;
+        p->restantes--;
+    }
+    p->pedidos++;
+    if (++p->em_uso > p->pico) p->pico = p->em_uso;
+    return no;
+}
+
+void pool_liberar(PoolNos *p, void *no) {
+    *(void **)no = p->livres;
+    p->livres = no;
+    p->em_uso--;
+    p->pedidos++;
+}
+
+// Devolve todos os nós de uma vez (o pool continua utilizável)
+void pool_resetar(PoolNos *p) {
+    for (int i = 0; i < p->qtd_blocos; i++) {
+        free(p->blocos[i]);
+    }
+    p->chamadas += p->qtd_blocos;
+    free(p->blocos);
+    p->blocos = NULL;
+    p->qtd_blocos = p->cap_blocos = 0;
+    p->livres = NULL;
+    p->proximo = NULL;
+    p->restantes = 0;
+    p->em_uso = 0;
+}
 
 //------------ Circular-Fit -------------------
+#define ID_LIVRE UINT32_MAX
+
 typedef struct Bloco {
-    char id;            // ID do processo (ou ' ' para livre)
-    int tam;            // Tamanho em KB
-    int end_ini;        // Endereço inicial
+    uint32_t id;        // ID do processo (ou ID_LIVRE)
+    uint64_t tam;       // Tamanho em KB
+    uint64_t end_ini;   // Endereço inicial
     bool alocado;       // True se alocado, False se livre
     struct Bloco *prox; // Próximo bloco na lista
     struct Bloco *ant;  // Bloco anterior na lista
+    int idx_heap;       // Posição no heap de blocos livres (-1 se fora dele)
+    int classe_tlsf;    // Lista segregada do TLSF, primeiro_nivel * TLSF_SL + segundo (-1 se fora delas)
+    struct Bloco *prox_livre; // Próximo bloco no anel de livres (Circular-Fit) ou na lista segregada (TLSF)
+    struct Bloco *ant_livre;  // Bloco anterior no anel de livres (NULL se fora dele ou no início da lista do TLSF)
 } Bloco;
 
-Bloco *primeiro = NULL;     // Ponteiro para o primeiro bloco da lista
-Bloco *ultimo_alocado = NULL;  // Ponteiro para o último bloco onde uma alocação ocorreu 
+#define POLITICA_WORST_FIT 1
+#define POLITICA_CIRCULAR_FIT 2
+#define POLITICA_TLSF 5         // Two-Level Segregated Fit
+
+#define POLITICA_BUDDY 3
+#define POLITICA_BUDDY2 4       // Buddy em árvore implícita
+
+// TLSF: o primeiro nível é a potência de dois do tamanho e o segundo divide cada potência em TLSF_SL faixas
+#define TLSF_SL_BITS 4
+#define TLSF_SL (1 << TLSF_SL_BITS)
+#define TLSF_FL (64 - TLSF_SL_BITS + 1)
+
+bool compactacao = false;      // --compactar, para as novas instâncias do particionamento variável
+
+// Uma instância do particionamento variável: cada simulação tem a sua lista, índice e estruturas de livres
+typedef struct MemoriaVariavel {
+    Bloco *primeiro;        // Ponteiro para o primeiro bloco da lista
+    Bloco *anel_busca;      // Ponteiro de busca (roving) no anel de blocos livres: onde a próxima busca começa
+    Bloco *pos_busca;       // Último bloco alocado pelo Circular-Fit (ou o que o absorveu numa junção)
+    int qtd_livres;         // Número de blocos no anel de livres
+    long coalescencias;     // Número de junções de blocos livres realizadas
+    TabelaPid indice;       // ID do processo -> Bloco alocado
+    PoolNos pool;           // Nós Bloco
+    int politica;           // POLITICA_WORST_FIT, POLITICA_CIRCULAR_FIT ou POLITICA_TLSF
+    uint64_t tam;           // Tamanho total (KB)
+    uint64_t ocupado;       // KB em blocos alocados
+    Contadores cont;
+
+    bool compactar;         // Compacta em vez de falhar quando o total livre comporta o pedido
+    long compactacoes;
+    long falhas_evitadas;
+    uint64_t kb_movidos;
+    double ns_compactacao;
+
+    Bloco **heap;           // Max-heap dos blocos livres, ordenado por tamanho (busca do Worst-Fit; nas
+                            // outras políticas só dá o maior livre)
+    int heap_qtd;
+    int heap_cap;
+
+    uint64_t mapa_fl;                   // TLSF: bit i ligado se alguma lista do primeiro nível i tem blocos
+    uint32_t mapa_sl[TLSF_FL];          // Bit j de mapa_sl[i] ligado se a lista (i, j) tem blocos
+    Bloco *listas_tlsf[TLSF_FL][TLSF_SL];
+} MemoriaVariavel;
+
+// Cria um novo bloco
+Bloco* criar_bloco(MemoriaVariavel *m, uint32_t id, uint64_t tam, uint64_t end_ini, bool alocado) {
+    Bloco *novo = pool_alocar(&m->pool);
+    novo->id = id;
+    novo->tam = tam;
+    novo->end_ini = end_ini;
+    novo->alocado = alocado;
+    novo->prox = NULL;
+    novo->ant = NULL;
+    novo->idx_heap = -1;
+    novo->classe_tlsf = -1;
+    novo->prox_livre = NULL;
+    novo->ant_livre = NULL;
+    return novo;
+}
+
+// ---- Heap de blocos livres (Worst-Fit) ----
+// Cada Bloco guarda sua posição no heap, então remoções e mudanças de tamanho são feitas no lugar em O(log n).
+void heap_trocar(MemoriaVariavel *m, int i, int j) {
+    Bloco *temp = m->heap[i];
+    m->heap[i] = m->heap[j];
+    m->heap[j] = temp;
+    m->heap[i]->idx_heap = i;
+    m->heap[j]->idx_heap = j;
+}
+
+// Prioridade do heap: maior tamanho; no empate, menor endereço (o mesmo bloco que a busca linear escolheria)
+bool heap_antes(Bloco *a, Bloco *b) {
+    return a->tam > b->tam || (a->tam == b->tam && a->end_ini < b->end_ini);
+}
+
+void heap_subir(MemoriaVariavel *m, int i) {
+    while (i > 0 && heap_antes(m->heap[i], m->heap[(i - 1) / 2])) {
+        heap_trocar(m, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void heap_descer(MemoriaVariavel *m, int i) {
+    while (1) {
+        int maior = i;
+        int esq = 2 * i + 1;
+        int dir = 2 * i + 2;
+        if (esq < m->heap_qtd && heap_antes(m->heap[esq], m->heap[maior])) maior = esq;
+        if (dir < m->heap_qtd && heap_antes(m->heap[dir], m->heap[maior])) maior = dir;
+        if (maior == i) break;
+        heap_trocar(m, i, maior);
+        i = maior;
+    }
+}
+
+void heap_inserir(MemoriaVariavel *m, Bloco *b) {
+    if (m->heap_qtd == m->heap_cap) {
+        m->heap_cap = m->heap_cap ? m->heap_cap * 2 : 64;
+        m->heap = realloc(m->heap, m->heap_cap * sizeof(Bloco *));
+        if (m->heap == NULL) {
+            perror("Erro ao alocar o heap de blocos livres");
+            exit(EXIT_FAILURE);
+        }
+    }
+    m->heap[m->heap_qtd] = b;
+    b->idx_heap = m->heap_qtd++;
+    heap_subir(m, b->idx_heap);
+}
+
+void heap_remover(MemoriaVariavel *m, Bloco *b) {
+    int i = b->idx_heap;
+    Bloco *ultimo = m->heap[--m->heap_qtd];
+    if (i != m->heap_qtd) {
+        m->heap[i] = ultimo;
+        ultimo->idx_heap = i;
+        heap_subir(m, i);
+        heap_descer(m, ultimo->idx_heap);
+    }
+    b->idx_heap = -1;
+}
+
+// O bloco novo herda a posição do antigo (usado quando o restante de uma divisão substitui o bloco escolhido)
+void heap_substituir(MemoriaVariavel *m, Bloco *antigo, Bloco *novo) {
+    int i = antigo->idx_heap;
+    m->heap[i] = novo;
+    novo->idx_heap = i;
+    antigo->idx_heap = -1;
+    heap_subir(m, i);
+    heap_descer(m, novo->idx_heap);
+}
+
+// ---- Anel de blocos livres (Circular-Fit) ----
+// Lista circular que encadeia apenas os blocos livres, em ordem de endereço. O ponteiro de busca fica
+// dentro do anel, então a busca nunca visita blocos alocados: ele é sempre o primeiro livre a partir de
+// pos_busca, o bloco onde a busca pela lista inteira começaria.
+
+// Insere o bloco ao lado do livre mais próximo em endereço, andando por ant/prox a partir dele
+void anel_inserir(MemoriaVariavel *m, Bloco *b) {
+    if (m->anel_busca == NULL) {
+        b->prox_livre = b;
+        b->ant_livre = b;
+        m->anel_busca = b;
+        m->qtd_livres++;
+        return;
+    }
+    Bloco *depois = b->prox, *antes = b->ant;
+    while (depois->ant_livre == NULL && antes->ant_livre == NULL) {
+        m->cont.visitados += 2;
+        depois = depois->prox;
+        antes = antes->ant;
+    }
+    if (depois->ant_livre == NULL) depois = antes->prox_livre;
+    b->prox_livre = depois;
+    b->ant_livre = depois->ant_livre;
+    depois->ant_livre->prox_livre = b;
+    depois->ant_livre = b;
+    m->qtd_livres++;
+}
+
+// O bloco b acabou de ficar livre (já com as junções): vira o ponteiro de busca se está entre pos_busca
+// e o ponteiro atual, ou seja, se a busca pela lista inteira o encontraria antes
+void anel_reposicionar(MemoriaVariavel *m, Bloco *b) {
+    uint64_t pos = m->pos_busca->end_ini, atual = m->anel_busca->end_ini, end = b->end_ini;
+    bool antes = pos <= atual ? (end >= pos && end < atual) : (end >= pos || end < atual);
+    if (antes) m->anel_busca = b;
+}
+
+void anel_remover(MemoriaVariavel *m, Bloco *b) {
+    if (b->prox_livre == b) {
+        m->anel_busca = NULL;
+    } else {
+        b->ant_livre->prox_livre = b->prox_livre;
+        b->prox_livre->ant_livre = b->ant_livre;
+        if (m->anel_busca == b) {
+            m->anel_busca = b->prox_livre; // A busca continua de onde parou
+        }
+    }
+    b->prox_livre = NULL;
+    b->ant_livre = NULL;
+    m->qtd_livres--;
+}
+
+// O bloco novo ocupa a posição do antigo no anel (inclusive como ponteiro de busca)
+void anel_substituir(MemoriaVariavel *m, Bloco *antigo, Bloco *novo) {
+    if (antigo->prox_livre == antigo) {
+        novo->prox_livre = novo;
+        novo->ant_livre = novo;
+    } else {
+        novo->prox_livre = antigo->prox_livre;
+        novo->ant_livre = antigo->ant_livre;
+        antigo->prox_livre->ant_livre = novo;
+        antigo->ant_livre->prox_livre = novo;
+    }
+    if (m->anel_busca == antigo) {
+        m->anel_busca = novo;
+    }
+    antigo->prox_livre = NULL;
+    antigo->ant_livre = NULL;
+}
+
+// ---- Listas segregadas (TLSF) ----
+// Uma lista de livres por classe de tamanho e dois níveis de bitmap apontando as listas não vazias,
+// então inserir, remover e achar a lista de um pedido custam O(1), sem depender do número de blocos.
+
+// Classe de um tamanho: abaixo de TLSF_SL KB há uma lista por tamanho exato
+void tlsf_classe(uint64_t tam, int *fl, int *sl) {
+    if (tam < TLSF_SL) {
+        *fl = 0;
+        *sl = (int)tam;
+        return;
+    }
+    int msb = 63 - __builtin_clzll(tam);
+    *fl = msb - TLSF_SL_BITS + 1;
+    *sl = (int)(tam >> (msb - TLSF_SL_BITS)) - TLSF_SL;
+}
+
+void tlsf_inserir(MemoriaVariavel *m, Bloco *b) {
+    int fl, sl;
+    tlsf_classe(b->tam, &fl, &sl);
+    Bloco **cabeca = &m->listas_tlsf[fl][sl];
+    b->ant_livre = NULL;
+    b->prox_livre = *cabeca;
+    if (*cabeca) (*cabeca)->ant_livre = b;
+    *cabeca = b;
+    b->classe_tlsf = fl * TLSF_SL + sl;
+    m->mapa_fl |= 1ull << fl;
+    m->mapa_sl[fl] |= 1u << sl;
+    m->qtd_livres++;
+}
+
+// Usa a classe guardada no bloco, que continua valendo mesmo se o tamanho já mudou
+void tlsf_remover(MemoriaVariavel *m, Bloco *b) {
+    int fl = b->classe_tlsf / TLSF_SL, sl = b->classe_tlsf % TLSF_SL;
+    if (b->ant_livre) {
+        b->ant_livre->prox_livre = b->prox_livre;
+    } else {
+        m->listas_tlsf[fl][sl] = b->prox_livre;
+        if (b->prox_livre == NULL) {
+            m->mapa_sl[fl] &= ~(1u << sl);
+            if (m->mapa_sl[fl] == 0) m->mapa_fl &= ~(1ull << fl);
+        }
+    }
+    if (b->prox_livre) b->prox_livre->ant_livre = b->ant_livre;
+    b->prox_livre = NULL;
+    b->ant_livre = NULL;
+    b->classe_tlsf = -1;
+    m->qtd_livres--;
+}
+
+// ---- Estruturas de blocos livres ----
+// Pontos únicos por onde os blocos livres entram, saem, mudam de tamanho ou são substituídos,
+// para que as estruturas da política ativa fiquem sempre sincronizadas com a lista.
+// Todas as políticas mantêm o heap: no Circular-Fit e no TLSF ele não guia a busca, mas dá o maior livre em
+// O(1) para a fragmentação, ao custo de O(log n) por bloco livre que entra, sai ou muda de tamanho.
+void livre_inserir(MemoriaVariavel *m, Bloco *b) {
+    if (m->politica == POLITICA_CIRCULAR_FIT) anel_inserir(m, b);
+    else if (m->politica == POLITICA_TLSF) tlsf_inserir(m, b);
+    if (m->politica != 0) heap_inserir(m, b);
+}
+
+void livre_remover(MemoriaVariavel *m, Bloco *b) {
+    if (b->classe_tlsf >= 0) tlsf_remover(m, b); // Antes do anel: o primeiro de cada lista segregada também tem ant_livre NULL
+    if (b->idx_heap >= 0) heap_remover(m, b);
+    if (b->ant_livre != NULL) anel_remover(m, b);
+}
+
+void livre_cresceu(MemoriaVariavel *m, Bloco *b) {
+    if (b->classe_tlsf >= 0) { // Pode ter mudado de classe
+        tlsf_remover(m, b);
+        tlsf_inserir(m, b);
+    }
+    if (b->idx_heap >= 0) heap_subir(m, b->idx_heap);
+}
+
+void livre_substituir(MemoriaVariavel *m, Bloco *antigo, Bloco *novo) {
+    if (antigo->classe_tlsf >= 0) { // O restante de uma divisão vai para a lista da sua própria classe
+        tlsf_remover(m, antigo);
+        tlsf_inserir(m, novo);
+    }
+    if (antigo->idx_heap >= 0) heap_substituir(m, antigo, novo);
+    if (antigo->ant_livre != NULL) anel_substituir(m, antigo, novo);
+}
+
+// Inicializa a instância com um único bloco grande e livre
+void iniciar_memoria(MemoriaVariavel *m, int politica, uint64_t tam_total) {
+    if (tam_total == 0 || (tam_total & (tam_total - 1)) != 0) {
+        printf("Erro: O tamanho da memoria deve ser uma potencia de dois e positivo.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(m, 0, sizeof(MemoriaVariavel)); // Sem busca anterior, heap e anel vazios
+    m->politica = politica;
+    m->tam = tam_total;
+    m->compactar = compactacao;
+    pool_iniciar(&m->pool, sizeof(Bloco));
+    m->primeiro = criar_bloco(m, ID_LIVRE, tam_total, 0, false);
+    m->primeiro->prox = m->primeiro; // Lista circular
+    m->primeiro->ant = m->primeiro;  // Lista duplamente encadeada e circular
+    tabela_iniciar(&m->indice, 64);
+    livre_inserir(m, m->primeiro);
+    m->pos_busca = m->primeiro; // Começa a busca do início
+    LOG("Memoria inicializada com %" PRIu64 " KB.\n", tam_total);
+}
+
+void mostrar_memoria(MemoriaVariavel *m) {
+    printf("\n--- Estado da Memoria ---\n");
+    if (m->primeiro == NULL) {
+        printf("Memoria vazia.\n");
+        return;
+    }
+
+    Bloco *atual = m->primeiro;
+    printf("|");
+    do {
+        printf(" %" PRIu64 " KB ", atual->tam);
+        if (atual->alocado) {
+            printf("(Proc %s) ", nome_processo(atual->id));
+        } else {
+            printf("(Livre) ");
+        }
+        printf("End: %" PRIu64 " |", atual->end_ini);
+        atual = atual->prox;
+    } while (atual != m->primeiro); // Percorre toda a lista circular
+
+    printf("\n");
+    printf("-------------------------\n");
+
+    printf("\n--- Blocos Livres Contiguos ---\n");
+    // A coalescência é imediata, então cada bloco livre já é uma sequência contígua inteira
+    int contador_contiguos_livres = 0;
+    if (m->heap_qtd == 0 && m->qtd_livres == 0) {
+        printf("Nenhum bloco livre contiguo encontrado.\n");
+    } else {
+        Bloco *p_atual = m->primeiro;
+        do {
+            if (!p_atual->alocado) {
+                contador_contiguos_livres++;
+                printf("Sequencia %d: %" PRIu64 " KB livres (comeca em End: %" PRIu64 ")\n",
+                       contador_contiguos_livres, p_atual->tam, p_atual->end_ini);
+            }
+            p_atual = p_atual->prox;
+        } while (p_atual != m->primeiro);
+    }
+    printf("-----------------------------------\n");
+}
+
+// Ocupa o bloco livre b com o processo. O que sobrar vira um novo bloco livre logo após b,
+// que herda o lugar de b nas estruturas de livres. Retorna o bloco livre criado (NULL em encaixe perfeito).
+Bloco* ocupar_bloco(MemoriaVariavel *m, Bloco *b, uint32_t id_proc, uint64_t tam_req) {
+    Bloco *novo_bloco_livre = NULL;
+
+    if (b->tam == tam_req) {
+        livre_remover(m, b);
+    } else {
+        novo_bloco_livre = criar_bloco(m, ID_LIVRE, b->tam - tam_req, b->end_ini + tam_req, false);
+        m->cont.divisoes++;
+
+        // Insere o novo bloco livre APÓS o bloco alocado
+        novo_bloco_livre->prox = b->prox;
+        novo_bloco_livre->ant = b;
+        b->prox->ant = novo_bloco_livre;
+        b->prox = novo_bloco_livre;
+        livre_substituir(m, b, novo_bloco_livre);
+        b->tam = tam_req;
+    }
+    b->id = id_proc;
+    b->alocado = true;
+    m->ocupado += tam_req;
+    return novo_bloco_livre;
+}
+
+// Primeiro bloco livre que comporta a requisição, procurando a partir de onde a busca anterior parou.
+// A busca circula só pelos blocos livres e passa a começar no bloco encontrado.
+Bloco* buscar_circular(MemoriaVariavel *m, uint64_t tam_req) {
+    Bloco *busca_atual = m->anel_busca;
+    for (int nos_verificados = 0; nos_verificados < m->qtd_livres; nos_verificados++) {
+        m->cont.visitados++;
+        if (busca_atual->tam >= tam_req) {
+            m->anel_busca = busca_atual;
+            m->pos_busca = busca_atual; // Será alocado: a próxima busca começa nele
+            return busca_atual; // Encontrou o primeiro bloco adequado
+        }
+        busca_atual = busca_atual->prox_livre;
+    }
+    return NULL;
+}
+
+// Compactação: desliza os blocos alocados para o início da memória, na mesma ordem, reescrevendo end_ini,
+// e junta todo o espaço livre em um único bloco no fim. Os nós alocados continuam os mesmos, então o índice
+// segue válido. Retorna o bloco livre resultante (NULL se a memória está cheia).
+Bloco* compactar_memoria(MemoriaVariavel *m) {
+    double inicio = agora_ns();
+    Bloco *atual = m->primeiro;
+    Bloco *primeiro_alocado = NULL, *ultimo = NULL;
+    uint64_t fim = 0;
+    long nos = m->pool.em_uso;
+
+    for (long i = 0; i < nos; i++) {
+        Bloco *prox = atual->prox;
+        if (atual->alocado) {
+            if (atual->end_ini != fim) {
+                atual->end_ini = fim;
+                m->kb_movidos += atual->tam;
+            }
+            fim += atual->tam;
+            if (ultimo) ultimo->prox = atual;
+            else primeiro_alocado = atual;
+            atual->ant = ultimo;
+            ultimo = atual;
+        } else {
+            livre_remover(m, atual);
+            pool_liberar(&m->pool, atual);
+        }
+        atual = prox;
+    }
+
+    Bloco *livre = NULL;
+    if (fim < m->tam) {
+        livre = criar_bloco(m, ID_LIVRE, m->tam - fim, fim, false);
+        livre->ant = ultimo;
+        if (ultimo) ultimo->prox = livre;
+        ultimo = livre;
+        livre_inserir(m, livre);
+    }
+    m->primeiro = primeiro_alocado ? primeiro_alocado : livre;
+    m->primeiro->ant = ultimo; // Fecha a lista circular
+    ultimo->prox = m->primeiro;
+    m->pos_busca = livre ? livre : m->primeiro; // Os nós livres antigos já voltaram ao pool
+
+    m->compactacoes++;
+    m->ns_compactacao += agora_ns() - inicio;
+    return livre;
+}
+
+// Sem bloco que comporte o pedido: com --compactar, compacta se o total livre basta
+Bloco* tentar_compactar(MemoriaVariavel *m, uint64_t tam_req) {
+    if (!m->compactar || m->ocupado == m->tam || m->tam - m->ocupado < tam_req) return NULL;
+    LOG("Nenhum bloco comporta %" PRIu64 " KB, mas ha %" PRIu64 " KB livres: compactando a memoria.\n",
+        tam_req, m->tam - m->ocupado);
+    m->falhas_evitadas++;
+    return compactar_memoria(m);
+}
+
+// Aloca memória usando a política Circular-Fit
+void alocar_memoria_circular(MemoriaVariavel *m, uint32_t id_proc, uint64_t tam_req) {
+    LOG("\nRequisicao: IN(%s, %" PRIu64 ")\n", nome_processo(id_proc), tam_req);
+
+    if (m->primeiro == NULL) {
+        printf("Erro: Memoria nao inicializada.\n");
+        return;
+    }
+
+    Bloco *bloco_encontrado = buscar_circular(m, tam_req);
+    if (bloco_encontrado == NULL) bloco_encontrado = tentar_compactar(m, tam_req);
+
+    if (bloco_encontrado != NULL) {
+        if (ocupar_bloco(m, bloco_encontrado, id_proc, tam_req) == NULL) {
+            // Encaixe perfeito
+            LOG("Alocado %" PRIu64 " KB para o processo %s (encaixe perfeito).\n", tam_req, nome_processo(id_proc));
+        } else {
+            // Divide o bloco existente
+            LOG("Alocado %" PRIu64 " KB para o processo %s (bloco dividido).\n", tam_req, nome_processo(id_proc));
+        }
+        // O ponteiro de busca já ficou no restante da divisão, ou no livre seguinte em encaixe perfeito
+        tabela_inserir(&m->indice, id_proc, bloco_encontrado);
+        m->cont.alocacoes++;
+    } else {
+        LOG("ESPACO INSUFICIENTE DE MEMORIA para o processo %s.\n", nome_processo(id_proc));
+        m->cont.falhas++;
+    }
+    if (deve_mostrar_estado(&m->cont)) mostrar_memoria(m); 
+}
+
+// Retira um bloco da lista circular e libera o nó
+void remover_bloco(MemoriaVariavel *m, Bloco *b) {
+    b->ant->prox = b->prox;
+    b->prox->ant = b->ant;
+    if (m->pos_busca == b) {
+        m->pos_busca = b->ant; // A busca passa a começar no bloco que absorveu b
+    }
+    pool_liberar(&m->pool, b);
+}
+
+// Junta um bloco recém-liberado com os vizinhos livres em O(1).
+// Como as marcas de fronteira, só olha ant/prox: o vizinho é adjacente se um termina onde o outro começa
+// (isso também impede juntar o último bloco com o primeiro pela volta da lista circular).
+Bloco* coalescer_bloco(MemoriaVariavel *m, Bloco *b) {
+    m->cont.visitados += 2;
+    Bloco *prox = b->prox;
+    if (prox != b && !prox->alocado && b->end_ini + b->tam == prox->end_ini) {
+        b->tam += prox->tam;
+        livre_remover(m, prox);
+        livre_cresceu(m, b);
+        remover_bloco(m, prox);
+        m->coalescencias++;
+        m->cont.fusoes++;
+    }
+
+    Bloco *ant = b->ant;
+    if (ant != b && !ant->alocado && ant->end_ini + ant->tam == b->end_ini) {
+        ant->tam += b->tam;
+        livre_remover(m, b);
+        livre_cresceu(m, ant);
+        remover_bloco(m, b);
+        m->coalescencias++;
+        m->cont.fusoes++;
+        b = ant;
+    }
+    return b;
+}
+
+// Devolve um bloco alocado às estruturas de livres e junta com os vizinhos
+Bloco* liberar_bloco(MemoriaVariavel *m, Bloco *b) {
+    b->alocado = false; // Marca como livre
+    b->id = ID_LIVRE;   // Limpa o ID do processo
+    m->ocupado -= b->tam;
+    livre_inserir(m, b);
+    b = coalescer_bloco(m, b);
+    if (m->politica == POLITICA_CIRCULAR_FIT) anel_reposicionar(m, b);
+    return b;
+}
+
+// Libera memória e tenta juntar blocos livres adjacentes
+void liberar_memoria(MemoriaVariavel *m, uint32_t id_proc) {
+    LOG("\nRequisicao: OUT(%s)\n", nome_processo(id_proc));
+
+    if (m->primeiro == NULL) {
+        printf("Erro: Memoria nao inicializada.\n");
+        return;
+    }
+
+    Bloco *bloco_liberado = tabela_buscar(&m->indice, id_proc); // O(1) pelo índice
+
+    if (bloco_liberado != NULL) {
+        tabela_remover(&m->indice, id_proc, bloco_liberado);
+        LOG("Memoria liberada para o processo %s.\n", nome_processo(id_proc));
+        liberar_bloco(m, bloco_liberado);
+        m->cont.liberacoes++;
+    }
+
+    if (deve_mostrar_estado(&m->cont)) mostrar_memoria(m); // Exibe o status da memória após a liberação
+}
+
+// Libera toda a memória alocada dinamicamente
+void limpar_memoria(MemoriaVariavel *m) {
+    if (m->primeiro == NULL) return;
+
+    pool_resetar(&m->pool); // Todos os nós voltam de uma vez, sem percorrer a lista
+    m->primeiro = NULL;
+    m->anel_busca = NULL;
+    m->pos_busca = NULL;
+    m->qtd_livres = 0;
+    m->mapa_fl = 0; // Listas do TLSF com nós já devolvidos: nenhuma fica marcada
+    tabela_limpar(&m->indice);
+    free(m->heap);
+    m->heap = NULL;
+    m->heap_qtd = m->heap_cap = 0;
+    LOG("\nMemoria limpa.\n");
+}
+
+// Ocupação atual: o maior livre é o topo do heap, que todas as políticas mantêm
+void fragmentacao_variavel(MemoriaVariavel *m, Fragmentacao *f) {
+    f->livre = m->tam - m->ocupado;
+    f->frag_interna = 0; // A partição tem exatamente o tamanho pedido
+    f->maior_livre = m->heap_qtd ? m->heap[0]->tam : 0;
+    f->blocos_livres = m->heap_qtd;
+}
+
+const char* nome_politica_variavel(int politica) {
+    if (politica == POLITICA_WORST_FIT) return "worst";
+    if (politica == POLITICA_TLSF) return "tlsf";
+    return "circular";
+}
+
+// Resumo final do particionamento variável
+void resumo_variavel(MemoriaVariavel *m, Resumo *r) {
+    Fragmentacao f;
+    fragmentacao_variavel(m, &f);
+    iniciar_resumo(r, nome_politica_variavel(m->politica), m->tam, &m->cont, &f);
+    r->nos = m->pool.em_uso; // Cada bloco da lista é um nó do pool
+    r->coalescencias = m->coalescencias;
+    r->compactacoes = m->compactacoes;
+    r->falhas_evitadas = m->falhas_evitadas;
+    r->kb_movidos = m->kb_movidos;
+    r->ms_compactacao = m->ns_compactacao / 1e6;
+    r->pico_nos = m->pool.pico;
+    r->chamadas_evitadas = m->pool.pedidos - m->pool.chamadas;
+}
+
+// Pico de memória de controle em bytes: nós, índice e heap (as capacidades só crescem)
+uint64_t metadados_variavel(MemoriaVariavel *m) {
+    return (uint64_t)m->pool.pico * m->pool.tam_no + (uint64_t)m->indice.capacidade * sizeof(EntradaPid)
+           + (uint64_t)m->heap_cap * sizeof(Bloco *);
+}
+
+// ---- Instantâneos ----
+// Os livres são gravados na ordem das estruturas da política: o anel a partir do ponteiro de busca e as listas
+// do TLSF da primeira à última posição. O heap do Worst-Fit desempata por endereço, então a ordem não importa.
+void capturar_variavel(void *contexto, Instantaneo *s) {
+    MemoriaVariavel *m = contexto;
+    uint64_t qtd_blocos = 0;
+    Bloco *b = m->primeiro;
+    do {
+        qtd_blocos++;
+        b = b->prox;
+    } while (b != m->primeiro);
+    uint64_t qtd_livres = m->politica == POLITICA_WORST_FIT ? (uint64_t)m->heap_qtd : (uint64_t)m->qtd_livres;
+    instantaneo_reservar(s, qtd_blocos, qtd_livres, m->indice.ocupadas);
+
+    uint64_t i = 0;
+    do {
+        s->blocos[i].inicio = b->end_ini;
+        s->blocos[i].tam = b->tam;
+        s->blocos[i].pid = b->id;
+        s->blocos[i].alocado = b->alocado;
+        s->blocos[i].lado = '-';
+        i++;
+        b = b->prox;
+    } while (b != m->primeiro);
+
+    i = 0;
+    if (m->politica == POLITICA_WORST_FIT) {
+        for (int j = 0; j < m->heap_qtd; j++) s->livres[i++] = m->heap[j]->end_ini;
+    } else if (m->politica == POLITICA_CIRCULAR_FIT) {
+        b = m->anel_busca;
+        for (int j = 0; j < m->qtd_livres; j++, b = b->prox_livre) s->livres[i++] = b->end_ini;
+    } else {
+        for (int fl = 0; fl < TLSF_FL; fl++) {
+            for (int sl = 0; sl < TLSF_SL; sl++) {
+                for (b = m->listas_tlsf[fl][sl]; b; b = b->prox_livre) s->livres[i++] = b->end_ini;
+            }
+        }
+    }
+    capturar_indice(s, &m->indice, offsetof(Bloco, end_ini));
+
+    instantaneo_contadores(s, &m->cont);
+    s->cab.tam_mem = m->tam;
+    s->cab.totais[0] = m->coalescencias;
+    s->cab.totais[1] = m->compactacoes;
+    s->cab.totais[2] = m->falhas_evitadas;
+    s->cab.totais[3] = m->kb_movidos;
+    s->cab.totais[4] = (uint64_t)m->ns_compactacao;
+    s->cab.totais[5] = m->pos_busca->end_ini;
+}
+
+// Reconstrói a lista, as estruturas de livres e o índice em O(n); a instância já foi iniciada
+bool restaurar_variavel(void *contexto, const Instantaneo *s) {
+    MemoriaVariavel *m = contexto;
+    limpar_memoria(m);
+    memset(m->mapa_sl, 0, sizeof(m->mapa_sl));
+    memset(m->listas_tlsf, 0, sizeof(m->listas_tlsf));
+    m->ocupado = 0;
+
+    Bloco **nos = malloc(s->cab.qtd_blocos * sizeof(Bloco *));
+    if (nos == NULL) {
+        perror("Erro ao alocar os blocos restaurados");
+        exit(EXIT_FAILURE);
+    }
+    for (uint64_t i = 0; i < s->cab.qtd_blocos; i++) {
+        const RegistroBloco *r = &s->blocos[i];
+        nos[i] = criar_bloco(m, r->alocado ? r->pid : ID_LIVRE, r->tam, r->inicio, r->alocado);
+        if (r->alocado) m->ocupado += r->tam;
+        nos[i]->ant = i ? nos[i - 1] : nos[i];
+        nos[i]->ant->prox = nos[i];
+    }
+    m->primeiro = nos[0];
+    m->primeiro->ant = nos[s->cab.qtd_blocos - 1];
+    m->primeiro->ant->prox = m->primeiro;
+
+    bool ok = restaurar_indice(&m->indice, s, (void **)nos);
+    for (uint64_t j = 0; ok && j < s->cab.qtd_livres; j++) {
+        // O TLSF insere no início das listas: de trás para frente, cada lista volta na ordem gravada
+        uint64_t k = m->politica == POLITICA_TLSF ? s->cab.qtd_livres - 1 - j : j;
+        long i = registro_do_endereco(s, s->livres[k]);
+        ok = i >= 0 && !nos[i]->alocado && nos[i]->idx_heap < 0 && nos[i]->classe_tlsf < 0
+             && nos[i]->ant_livre == NULL && nos[i] != m->anel_busca;
+        if (ok) livre_inserir(m, nos[i]);
+    }
+    long pos = registro_do_endereco(s, s->cab.totais[5]);
+    ok = ok && pos >= 0;
+    if (ok) m->pos_busca = nos[pos];
+    free(nos);
+
+    restaurar_contadores(&m->cont, s);
+    m->coalescencias = s->cab.totais[0];
+    m->compactacoes = s->cab.totais[1];
+    m->falhas_evitadas = s->cab.totais[2];
+    m->kb_movidos = s->cab.totais[3];
+    m->ns_compactacao = s->cab.totais[4];
+    return ok;
+}
+
+const OperacoesEstado estado_variavel = {capturar_variavel, restaurar_variavel};
+
+void executar_circular(void *contexto, Requisicao *req) {
+    MemoriaVariavel *m = contexto;
+    iniciar_requisicao(&m->cont, req->op);
+    if (req->op == REQ_IN) {
+        alocar_memoria_circular(m, req->id, req->tam);
+    } else {
+        liberar_memoria(m, req->id);
+    }
+}
+
+void amostrar_variavel(void *contexto, Fragmentacao *f) {
+    fragmentacao_variavel(contexto, f);
+}
+
+int Runcircularfit(uint64_t tam_total_memoria, const char *nome_arquivo) {
+    MemoriaVariavel memoria;
+    MemoriaVariavel *m = &memoria;
+    iniciar_memoria(m, POLITICA_CIRCULAR_FIT, tam_total_memoria);
+    instrumentacao_iniciar(&m->cont, "circular");
+
+    int status = processar_com_serie(nome_arquivo, executar_circular, m, amostrar_variavel, &m->cont,
+                                     POLITICA_CIRCULAR_FIT, "circular", tam_total_memoria, &estado_variavel);
+
+    if (status == 0) {
+        Resumo r;
+        resumo_variavel(m, &r);
+        imprimir_resumo(&r);
+    }
+    instrumentacao_finalizar(&m->cont);
+    limpar_memoria(m);
+    return status;
+}
+
+// ----- Worst-Fit -------------------
+// Maior bloco livre que comporta a requisição: o topo do heap, em O(1)
+Bloco* buscar_worst_fit(MemoriaVariavel *m, uint64_t tam_req) {
+    m->cont.visitados++;
+    if (m->heap_qtd > 0 && m->heap[0]->tam >= tam_req) {
+        return m->heap[0];
+    }
+    return NULL;
+}
+
+// Busca linear original (percorre todos os blocos); mantida para comparação no benchmark
+Bloco* buscar_worst_fit_linear(MemoriaVariavel *m, uint64_t tam_req) {
+    Bloco *atual = m->primeiro;
+    Bloco *bloco_worst_fit = NULL; // Este será o bloco final escolhido
+
+    do {
+        m->cont.visitados++;
+        // Verifica se o bloco atual está livre e se o tamanho dele é suficiente para a requisição
+        if (!atual->alocado && atual->tam >= tam_req) {
+            // Se o tamanho do bloco atual é maior do que o maior tamanho livre encontrado até agora
+            if (bloco_worst_fit == NULL || atual->tam > bloco_worst_fit->tam) {
+                bloco_worst_fit = atual;      // Este bloco é o novo candidato a pior ajuste
+            }
+        }
+        atual = atual->prox;
+    } while (atual != m->primeiro); // Continua até ter percorrido a lista inteira
+    return bloco_worst_fit;
+}
+
+void alocar_memoria_worst_fit(MemoriaVariavel *m, uint32_t id_proc, uint64_t tam_req) {
+    LOG("\nRequisicao: IN(%s, %" PRIu64 ") - Worst-Fit\n", nome_processo(id_proc), tam_req);
+
+    if (m->primeiro == NULL) {
+        printf("Erro: Memoria nao inicializada.\n");
+        return;
+    }
+
+    // Passo 1: Encontrar o maior bloco livre que se encaixa
+    Bloco *bloco_worst_fit = buscar_worst_fit(m, tam_req);
+    if (bloco_worst_fit == NULL) bloco_worst_fit = tentar_compactar(m, tam_req);
+
+    // Passo 2: Tentar alocar no bloco encontrado (se houver)
+    if (bloco_worst_fit != NULL) {
+        Bloco *novo_bloco_livre = ocupar_bloco(m, bloco_worst_fit, id_proc, tam_req);
+        if (novo_bloco_livre == NULL) {
+            // Encaixe perfeito no maior bloco livre (não há fragmentação interna)
+            LOG("Alocado %" PRIu64 " KB para o processo %s (encaixe perfeito no maior bloco).\n", tam_req, nome_processo(id_proc));
+        } else {
+            LOG("Alocado %" PRIu64 " KB para o processo %s (maior bloco dividido, %" PRIu64 " KB restantes).\n", tam_req, nome_processo(id_proc), novo_bloco_livre->tam);
+        }
+        tabela_inserir(&m->indice, id_proc, bloco_worst_fit);
+        m->cont.alocacoes++;
+    } else {
+        LOG("ESPACO INSUFICIENTE DE MEMORIA para o processo %s.\n", nome_processo(id_proc));
+        m->cont.falhas++;
+    }
+    if (deve_mostrar_estado(&m->cont)) mostrar_memoria(m);
+}
+
+void executar_worst_fit(void *contexto, Requisicao *req) {
+    MemoriaVariavel *m = contexto;
+    iniciar_requisicao(&m->cont, req->op);
+    if (req->op == REQ_IN) {
+        alocar_memoria_worst_fit(m, req->id, req->tam);
+    } else {
+        liberar_memoria(m, req->id);
+    }
+}
+
+int Runworst_fit(uint64_t tam_mem, const char *nome_arquivo){
+    MemoriaVariavel memoria;
+    MemoriaVariavel *m = &memoria;
+    iniciar_memoria(m, POLITICA_WORST_FIT, tam_mem);
+    instrumentacao_iniciar(&m->cont, "worst");
+
+    int status = processar_com_serie(nome_arquivo, executar_worst_fit, m, amostrar_variavel, &m->cont,
+                                     POLITICA_WORST_FIT, "worst", tam_mem, &estado_variavel);
+
+    if (status == 0) {
+        Resumo r;
+        resumo_variavel(m, &r);
+        imprimir_resumo(&r);
+    }
+    instrumentacao_finalizar(&m->cont);
+    limpar_memoria(m);
+    return status;
+}
+
+// ----- TLSF -------------------
+// Good-fit em O(1): o pedido é arredondado para o início da classe seguinte, então qualquer bloco dali
+// em diante comporta o pedido e basta o primeiro da lista não vazia mais baixa, achada pelos bitmaps.
+// Um bloco da própria classe do pedido que ainda comportaria só é tentado quando nada acima está livre,
+// e só o primeiro da lista, para a busca continuar sem percorrer listas.
+Bloco* buscar_tlsf(MemoriaVariavel *m, uint64_t tam_req) {
+    m->cont.visitados++;
+    int fl, sl;
+    uint64_t arredondado = tam_req;
+    if (tam_req >= TLSF_SL) arredondado += (1ull << (63 - __builtin_clzll(tam_req) - TLSF_SL_BITS)) - 1;
+    if (arredondado >= tam_req) {
+        tlsf_classe(arredondado, &fl, &sl);
+        uint32_t mapa = m->mapa_sl[fl] & (~0u << sl);
+        if (mapa == 0) {
+            uint64_t acima = fl + 1 < TLSF_FL ? m->mapa_fl & (~0ull << (fl + 1)) : 0;
+            if (acima) {
+                fl = __builtin_ctzll(acima);
+                mapa = m->mapa_sl[fl];
+            }
+        }
+        if (mapa) return m->listas_tlsf[fl][__builtin_ctz(mapa)];
+    }
+    tlsf_classe(tam_req, &fl, &sl);
+    Bloco *b = m->listas_tlsf[fl][sl];
+    return b != NULL && b->tam >= tam_req ? b : NULL;
+}
+
+void alocar_memoria_tlsf(MemoriaVariavel *m, uint32_t id_proc, uint64_t tam_req) {
+    LOG("\nRequisicao: IN(%s, %" PRIu64 ") - TLSF\n", nome_processo(id_proc), tam_req);
+
+    if (m->primeiro == NULL) {
+        printf("Erro: Memoria nao inicializada.\n");
+        return;
+    }
+
+    Bloco *bloco = buscar_tlsf(m, tam_req);
+    if (bloco == NULL) bloco = tentar_compactar(m, tam_req);
+
+    if (bloco != NULL) {
+        Bloco *novo_bloco_livre = ocupar_bloco(m, bloco, id_proc, tam_req);
+        if (novo_bloco_livre == NULL) {
+            LOG("Alocado %" PRIu64 " KB para o processo %s (encaixe perfeito).\n", tam_req, nome_processo(id_proc));
+        } else {
+            LOG("Alocado %" PRIu64 " KB para o processo %s (bloco dividido, %" PRIu64 " KB restantes).\n", tam_req, nome_processo(id_proc), novo_bloco_livre->tam);
+        }
+        tabela_inserir(&m->indice, id_proc, bloco);
+        m->cont.alocacoes++;
+    } else {
+        LOG("ESPACO INSUFICIENTE DE MEMORIA para o processo %s.\n", nome_processo(id_proc));
+        m->cont.falhas++;
+    }
+    if (deve_mostrar_estado(&m->cont)) mostrar_memoria(m);
+}
+
+void executar_tlsf(void *contexto, Requisicao *req) {
+    MemoriaVariavel *m = contexto;
+    iniciar_requisicao(&m->cont, req->op);
+    if (req->op == REQ_IN) {
+        alocar_memoria_tlsf(m, req->id, req->tam);
+    } else {
+        liberar_memoria(m, req->id);
+    }
+}
+
+int Runtlsf(uint64_t tam_mem, const char *nome_arquivo) {
+    MemoriaVariavel memoria;
+    MemoriaVariavel *m = &memoria;
+    iniciar_memoria(m, POLITICA_TLSF, tam_mem);
+    instrumentacao_iniciar(&m->cont, "tlsf");
+
+    int status = processar_com_serie(nome_arquivo, executar_tlsf, m, amostrar_variavel, &m->cont,
+                                     POLITICA_TLSF, "tlsf", tam_mem, &estado_variavel);
+
+    if (status == 0) {
+        Resumo r;
+        resumo_variavel(m, &r);
+        imprimir_resumo(&r);
+    }
+    instrumentacao_finalizar(&m->cont);
+    limpar_memoria(m);
+    return status;
+}
+
+// Busca da política variável pelo código POLITICA_*
+Bloco* buscar_variavel(MemoriaVariavel *m, uint64_t tam_req) {
+    if (m->politica == POLITICA_WORST_FIT) return buscar_worst_fit(m, tam_req);
+    if (m->politica == POLITICA_TLSF) return buscar_tlsf(m, tam_req);
+    return buscar_circular(m, tam_req);
+}
+
+ExecutarRequisicao executor_variavel(int politica) {
+    if (politica == POLITICA_WORST_FIT) return executar_worst_fit;
+    if (politica == POLITICA_TLSF) return executar_tlsf;
+    return executar_circular;
+}
+
+#define BENCH_ALOCACOES 200 // Alocações medidas por tamanho de lista
+
+// Monta n blocos livres de 1 KB separados por blocos alocados, seguidos do bloco livre restante,
+// e mede o tempo médio de uma alocação Worst-Fit (que sempre cai no bloco restante).
+double medir_worst_fit(int n, bool usar_heap) {
+    int tam_total = 1;
+    while (tam_total < 2 * n + 2 * BENCH_ALOCACOES + 1) tam_total <<= 1;
+
+    MemoriaVariavel memoria;
+    MemoriaVariavel *m = &memoria;
+    iniciar_memoria(m, usar_heap ? POLITICA_WORST_FIT : 0, tam_total); // Sem heap, a busca linear não paga sua manutenção
+
+    Bloco **fragmentos = malloc(2 * n * sizeof(Bloco *));
+    for (int i = 0; i < 2 * n; i++) {
+        fragmentos[i] = m->primeiro->ant; // O último bloco é sempre o livre restante
+        ocupar_bloco(m, fragmentos[i], 0, 1);
+    }
+    for (int i = 0; i < 2 * n; i += 2) {
+        liberar_bloco(m, fragmentos[i]);
+    }
+    free(fragmentos);
+
+    Bloco *alocados[BENCH_ALOCACOES];
+    double inicio = agora_ns();
+    for (int i = 0; i < BENCH_ALOCACOES; i++) {
+        alocados[i] = usar_heap ? buscar_worst_fit(m, 2) : buscar_worst_fit_linear(m, 2);
+        ocupar_bloco(m, alocados[i], 1, 2);
+    }
+    double fim = agora_ns();
+
+    for (int i = BENCH_ALOCACOES - 1; i >= 0; i--) {
+        liberar_bloco(m, alocados[i]);
+    }
+    limpar_memoria(m);
+    return (fim - inicio) / BENCH_ALOCACOES;
+}
+
+// Compara a busca pelo heap com a busca linear de 10^3 a 10^6 blocos
+void benchmark_worst_fit() {
+    double res_heap[4], res_linear[4];
+    int tamanhos[4] = {1000, 10000, 100000, 1000000};
+
+    for (int i = 0; i < 4; i++) {
+        res_heap[i] = medir_worst_fit(tamanhos[i], true);
+        res_linear[i] = medir_worst_fit(tamanhos[i], false);
+    }
+
+    printf("\n--- Benchmark Worst-Fit (ns por alocacao) ---\n");
+    printf("%-12s %-14s %-14s %s\n", "Blocos", "Heap", "Linear", "Ganho");
+    for (int i = 0; i < 4; i++) {
+        printf("%-12d %-14.1f %-14.1f %.1fx\n", 2 * tamanhos[i],
+               res_heap[i], res_linear[i], res_linear[i] / res_heap[i]);
+    }
+    printf("---------------------------------------------\n");
+}
+// ------------- BUDDY -------------------
+int ordem_minima = 0;    // Menor Block é de 2^ordem_minima KB (ex.: 2 = páginas de 4 KB), para as novas instâncias
+
+// Estrutura de Block de memória (Buddy)
+typedef struct BlockBuddy {
+    uint64_t inicio;     // Início do Block na memória
+    uint64_t tam;        // Tamanho do Block
+    int status;          // 1 se está livre, 0 se está alocado
+    uint32_t pid;        // ID do processo (ID_LIVRE se livre)
+    uint64_t tam_pedido; // Tamanho realmente pedido pelo processo
+    char lado;           // 'L', 'R' ou '-' para raiz
+    bool adiado;         // Livre sem ter tentado a fusão (modo preguiçoso)
+    int ordem;           // log2(tam): índice da lista livre do Block
+    struct BlockBuddy* next; // Próximo Block
+    struct BlockBuddy* prev; // Block anterior (a lista está em ordem de endereço)
+    struct BlockBuddy* next_livre; // Próximo Block livre da mesma ordem
+    struct BlockBuddy* prev_livre; // Block livre anterior da mesma ordem
+} BlockBuddy;
+
+#define MAX_ORDEM_BUDDY 64
 
-// Cria um novo bloco
-Bloco* criar_bloco(char id, int tam, int end_ini, bool alocado) {
-    Bloco *novo = (Bloco *)malloc(sizeof(Bloco));
-    if (novo == NULL) {
-        perror("Erro ao alocar memoria para o bloco");
+// ---- Camada slab (opcional) ----
+// Pedidos pequenos viram objetos de classes de tamanho fixo, recortados de Blocks do buddy (slabs),
+// como no SLUB: cada classe guarda seus slabs parciais e só pede um Block novo quando não há nenhum.
+#define CLASSES_SLAB 8
+#define MAIOR_CLASSE_SLAB 16
+#define ORDEM_SLAB 6             // Slabs de 64 KB (ou do Block mínimo, se ele for maior)
+#define VAZIOS_SLAB 1            // Slabs vazios mantidos por classe antes de devolver ao buddy
+#define ID_SLAB (ID_LIVRE - 1)   // "Processo" dos Blocks ocupados por slabs
+const uint64_t tam_classe_slab[CLASSES_SLAB] = {1, 2, 3, 4, 6, 8, 12, 16};
+const int classe_do_tam[MAIOR_CLASSE_SLAB + 1] = {0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7};
+bool usar_slab = false;          // --slab, para as novas instâncias do Buddy em lista
+int max_adiados = 0;             // --adiar N: Blocks livres sem fusão por ordem (0 = fusão imediata)
+
+typedef struct ObjetoSlab {
+    struct Slab *slab;
+    struct ObjetoSlab *prox_livre;
+    uint64_t tam_pedido;
+} ObjetoSlab;
+
+typedef struct Slab {
+    BlockBuddy *block;           // Block do buddy que o slab ocupa
+    int classe;
+    int em_uso;                  // Objetos ocupados
+    ObjetoSlab *livres;          // Objetos livres do slab
+    struct Slab *prox, *ant;     // Lista de parciais ou de cheios da classe
+    ObjetoSlab objetos[];
+} Slab;
+
+typedef struct ClasseSlab {
+    Slab *parciais;              // Slabs com algum objeto livre (inclusive os vazios mantidos)
+    Slab *cheios;                // Sem objetos livres; só são percorridos ao destruir a instância
+    int objetos_por_slab;
+    int slabs;
+    int vazios;
+    long em_uso;
+    long pedidos;                // INs da classe
+    long acertos;                // INs atendidos sem chamar o buddy
+    uint64_t frag_interna;       // Soma de (classe - pedido) dos objetos em uso
+} ClasseSlab;
+
+// Uma instância do Buddy em lista
+typedef struct MemoriaBuddy {
+    BlockBuddy *head;                     // Primeiro Block (endereço 0)
+    BlockBuddy *livres[MAX_ORDEM_BUDDY];  // Uma lista de Blocks livres por ordem (potência de 2)
+    uint64_t mapa_ordens;                 // Bit k ligado se a lista livres[k] não está vazia
+    uint64_t tam;                         // Tamanho total (KB)
+    uint64_t ocupado;                     // KB em Blocks alocados
+    uint64_t pedido;                      // KB pedidos pelos processos desses Blocks
+    int qtd_livres;                       // Blocks nas listas livres
+    int ordem_minima;
+    TabelaPid indice;                     // PID -> Block alocado
+    PoolNos pool;                         // Nós BlockBuddy
+    Contadores cont;
+
+    long divisoes;                        // Totais da execução (os de cont são por requisição)
+    long fusoes;
+
+    // Modo preguiçoso: um Block liberado fica na lista da sua ordem sem tentar a fusão, até marca[k] Blocks
+    // por ordem; as fusões pendentes só são feitas quando um pedido não encontra nenhuma ordem livre.
+    int marca[MAX_ORDEM_BUDDY];
+    int adiados[MAX_ORDEM_BUDDY];
+    int qtd_adiados;
+    long fusoes_adiadas;                  // Liberações que não tentaram a fusão
+    long descarregamentos;                // Vezes em que as fusões pendentes foram feitas
+    struct MemoriaBuddy *imediato;        // Réplica com fusão imediata, para medir o trabalho evitado
+
+    bool usar_slab;
+    uint64_t tam_slab;                    // KB de cada slab
+    ClasseSlab classes[CLASSES_SLAB];
+    uint64_t meta_slab, pico_meta_slab;   // Bytes dos descritores de slab
+} MemoriaBuddy;
+
+// Menor ordem k tal que 2^k >= tam
+int OrdemTeto(uint64_t tam) {
+    if (tam <= 1) return 0;
+    return 64 - __builtin_clzll(tam - 1);
+}
+
+// Coloca o Block no início da lista livre da sua ordem
+void PushLivre(MemoriaBuddy *m, BlockBuddy* Block) {
+    int k = Block->ordem;
+    Block->prev_livre = NULL;
+    Block->next_livre = m->livres[k];
+    if (m->livres[k]) m->livres[k]->prev_livre = Block;
+    m->livres[k] = Block;
+    m->mapa_ordens |= 1ull << k;
+    m->qtd_livres++;
+}
+
+// Retira o Block da lista livre da sua ordem em O(1)
+void RemoveLivre(MemoriaBuddy *m, BlockBuddy* Block) {
+    int k = Block->ordem;
+    if (Block->prev_livre) Block->prev_livre->next_livre = Block->next_livre;
+    else m->livres[k] = Block->next_livre;
+    if (Block->next_livre) Block->next_livre->prev_livre = Block->prev_livre;
+    Block->next_livre = Block->prev_livre = NULL;
+    if (!m->livres[k]) m->mapa_ordens &= ~(1ull << k);
+    m->qtd_livres--;
+    if (Block->adiado) { // Alocado ou fundido: deixa de estar pendente
+        Block->adiado = false;
+        m->adiados[k]--;
+        m->qtd_adiados--;
+    }
+}
+
+// Cria a instância com o primeiro bloco do buddy, adiando até adiar fusões por ordem
+void IniciaBuddy(MemoriaBuddy *m, uint64_t tam_total, int adiar) {
+    memset(m, 0, sizeof(MemoriaBuddy));
+    m->tam = tam_total;
+    m->ordem_minima = ordem_minima;
+    pool_iniciar(&m->pool, sizeof(BlockBuddy));
+    BlockBuddy* Block = pool_alocar(&m->pool);
+    Block->inicio = 0;          
+    Block->tam = tam_total;     
+    Block->lado = '-';     
+    Block->status = 1;
+    Block->pid = ID_LIVRE;
+    Block->tam_pedido = 0;
+    Block->ordem = OrdemTeto(tam_total);
+    Block->adiado = false;
+    Block->next = NULL;
+    Block->prev = NULL;
+
+    m->head = Block;
+    PushLivre(m, Block);
+    tabela_iniciar(&m->indice, 64);
+
+    m->tam_slab = 1ull << (ORDEM_SLAB > m->ordem_minima ? ORDEM_SLAB : m->ordem_minima);
+    m->usar_slab = usar_slab && m->tam_slab < tam_total;
+    for (int c = 0; c < CLASSES_SLAB; c++) {
+        m->classes[c].objetos_por_slab = (int)(m->tam_slab / tam_classe_slab[c]);
+    }
+    // Marca d'água por ordem: até adiar Blocks, sem que os pendentes de uma ordem passem de 1/8 da memória
+    for (int k = 0; k < MAX_ORDEM_BUDDY; k++) {
+        uint64_t limite = (tam_total / 8) >> k;
+        m->marca[k] = limite < (uint64_t)adiar ? (int)limite : adiar;
+    }
+}
+
+// Instância das simulações: com --adiar, ganha também a réplica com fusão imediata
+void InitBlock(MemoriaBuddy *m, uint64_t tam_total) {
+    IniciaBuddy(m, tam_total, max_adiados);
+    if (max_adiados > 0) {
+        m->imediato = malloc(sizeof(MemoriaBuddy));
+        if (m->imediato == NULL) {
+            perror("Erro ao alocar a replica do buddy");
+            exit(EXIT_FAILURE);
+        }
+        IniciaBuddy(m->imediato, tam_total, 0);
+    }
+}
+
+// Libera todos os nós da instância
+void DestroyBuddy(MemoriaBuddy *m) {
+    if (m->imediato) {
+        DestroyBuddy(m->imediato);
+        free(m->imediato);
+        m->imediato = NULL;
+    }
+    for (int c = 0; c < CLASSES_SLAB; c++) {
+        Slab *listas[2] = {m->classes[c].parciais, m->classes[c].cheios};
+        for (int l = 0; l < 2; l++) {
+            while (listas[l]) {
+                Slab *prox = listas[l]->prox;
+                free(listas[l]);
+                listas[l] = prox;
+            }
+        }
+        m->classes[c].parciais = m->classes[c].cheios = NULL;
+    }
+    pool_resetar(&m->pool);
+    tabela_limpar(&m->indice);
+    m->head = NULL;
+}
+
+// Divide recursivamente o Block até chegar no tamanho desejado.
+// O Block já deve ter sido retirado da lista livre; as metades direitas vão para a lista da sua ordem.
+void SplitBlock(MemoriaBuddy *m, BlockBuddy* Block, uint64_t target) {
+    while (Block->tam / 2 >= target) {
+        m->cont.divisoes++;
+        m->divisoes++;
+        BlockBuddy* buddy = pool_alocar(&m->pool); // Cria um novo bloco de metade do tamanho 
+        buddy->tam = Block->tam / 2;                    
+        buddy->inicio = Block->inicio + buddy->tam;     
+        buddy->status = 1;
+        buddy->pid = ID_LIVRE;
+        buddy->tam_pedido = 0;
+        buddy->lado = 'R';
+        buddy->adiado = false;
+        buddy->ordem = Block->ordem - 1;
+        buddy->next = Block->next;
+        buddy->prev = Block;
+        if (Block->next) Block->next->prev = buddy;
+
+        Block->tam = buddy->tam;
+        Block->ordem--;
+        Block->next = buddy;
+        Block->lado = 'L';         // Prioriza o bloco esquerdo a cada split
+        PushLivre(m, buddy);
+
+        LOG("Dividindo Block de %" PRIu64 " KB em %" PRIu64 " L e %" PRIu64 " R\n",
+                       Block->tam * 2, Block->tam, buddy->tam);
+    }
+}
+
+void DescarregaAdiados(MemoriaBuddy *m);
+
+// Reserva um Block para tam_req KB, sem registrar o processo. Retorna NULL se não há espaço.
+BlockBuddy* ReservaBlock(MemoriaBuddy *m, uint64_t tam_req) {
+    int k = OrdemTeto(tam_req);  // Arredonda para a potência de 2 mais próxima (ex: Req 30kb, tam 32kb)
+    if (k < m->ordem_minima) k = m->ordem_minima;
+
+    // Menor ordem >= k com Block livre: um ctz sobre o mapa de ordens
+    uint64_t mascara = (k < MAX_ORDEM_BUDDY) ? ~((1ull << k) - 1) : 0;
+    uint64_t candidatas = m->mapa_ordens & mascara;
+    if (candidatas == 0 && m->qtd_adiados > 0) { // Só agora as fusões pendentes fazem falta
+        DescarregaAdiados(m);
+        candidatas = m->mapa_ordens & mascara;
+    }
+    if (candidatas == 0) return NULL;
+
+    BlockBuddy* atual = m->livres[__builtin_ctzll(candidatas)];
+    m->cont.visitados++;
+    RemoveLivre(m, atual);
+    SplitBlock(m, atual, 1ull << k); // Divide bloco se o tamanho ainda não é o mínimo para o processo 
+
+    atual->status = 0;                             
+    atual->tam_pedido = tam_req;
+    m->ocupado += atual->tam;
+    m->pedido += tam_req;
+    return atual;
+}
+
+ObjetoSlab* ReservaObjeto(MemoriaBuddy *m, uint64_t tam_req);
+int EncolheSlabs(MemoriaBuddy *m);
+
+// Aloca memória usando Buddy. Com a camada slab, pedidos pequenos tentam primeiro um objeto de slab;
+// o índice marca esses objetos com o bit baixo do ponteiro.
+int AllocBlock(MemoriaBuddy *m, uint32_t pid, uint64_t tam_req) {
+    if (m->usar_slab && tam_req <= MAIOR_CLASSE_SLAB) {
+        ObjetoSlab *obj = ReservaObjeto(m, tam_req);
+        if (obj) {
+            tabela_inserir(&m->indice, pid, (void *)((uintptr_t)obj | 1));
+            m->cont.alocacoes++;
+            LOG("> Alocando %s com tamanho %" PRIu64 " em objeto de %" PRIu64 " KB (slab)\n",
+                nome_processo(pid), tam_req, tam_classe_slab[obj->slab->classe]);
+            return 0;
+        }
+    }
+    BlockBuddy* atual = ReservaBlock(m, tam_req);
+    if (atual == NULL && EncolheSlabs(m) > 0) atual = ReservaBlock(m, tam_req); // Espaço de slabs vazios
+    if (atual == NULL) {
+        LOG("ESPACO INSUFICIENTE DE MEMORIA\n");
+        m->cont.falhas++;
+        return -1;
+    }
+    atual->pid = pid;
+    tabela_inserir(&m->indice, pid, atual);
+    m->cont.alocacoes++;
+    LOG("> Alocando %s com tamanho %" PRIu64 " para Block [%" PRIu64 " %c]\n",
+                    nome_processo(pid), tam_req, atual->tam, atual->lado);
+    return 0;
+}
+
+
+// Buddy livre do Block, pronto para a fusão, ou NULL.
+// O buddy de [inicio, tam) começa em inicio ^ tam. Como a lista está em ordem de endereço,
+// ele só pode ser o vizinho seguinte (metade L) ou o anterior (metade R).
+BlockBuddy* BuddyLivre(MemoriaBuddy *m, BlockBuddy *atual) {
+    if (atual->tam >= m->tam) return NULL;
+    BlockBuddy *buddy = (atual->inicio & atual->tam) ? atual->prev : atual->next;
+    m->cont.visitados++;
+    if (!buddy || !buddy->status || buddy->tam != atual->tam || buddy->inicio != (atual->inicio ^ atual->tam))
+        return NULL;
+    return buddy;
+}
+
+// Junta um Block livre (fora das listas) com os buddies livres, subindo pelas ordens. Retorna o Block final.
+BlockBuddy* FundeBlock(MemoriaBuddy *m, BlockBuddy *atual) {
+    BlockBuddy *buddy;
+    while ((buddy = BuddyLivre(m, atual)) != NULL)
+    {
+        RemoveLivre(m, buddy);
+        BlockBuddy *esq = (buddy->inicio < atual->inicio) ? buddy : atual;
+        BlockBuddy *dir = (esq == buddy) ? atual : buddy;
+
+        esq->tam *= 2;
+        esq->ordem++;
+        m->cont.fusoes++;
+        m->fusoes++;
+        esq->next = dir->next;
+        if (dir->next) dir->next->prev = esq;
+        pool_liberar(&m->pool, dir);
+        atual = esq;
+    }
+    return atual;
+}
+
+// Devolve um Block reservado e junta com os buddies livres. No modo preguiçoso, se houver fusão a fazer
+// e a ordem ainda estiver abaixo da marca d'água, o Block fica pendente na lista da sua ordem.
+void LiberaBlock(MemoriaBuddy *m, BlockBuddy *atual)
+{
+    m->ocupado -= atual->tam;
+    m->pedido -= atual->tam_pedido;
+    atual->status = 1;        
+    atual->tam_pedido = 0;
+    atual->pid = ID_LIVRE;
+
+    int k = atual->ordem;
+    if (m->adiados[k] < m->marca[k] && BuddyLivre(m, atual) != NULL) {
+        atual->adiado = true;
+        m->adiados[k]++;
+        m->qtd_adiados++;
+        m->fusoes_adiadas++;
+        PushLivre(m, atual);
+        return;
+    }
+    PushLivre(m, FundeBlock(m, atual));
+}
+
+// Faz as fusões pendentes, da menor ordem para a maior. Ao final não sobra par de buddies livres,
+// como na fusão imediata.
+void DescarregaAdiados(MemoriaBuddy *m) {
+    m->descarregamentos++;
+    LOG("Fazendo as fusoes adiadas de %d Blocks\n", m->qtd_adiados);
+    for (int k = 0; k < MAX_ORDEM_BUDDY && m->qtd_adiados > 0; k++) {
+        BlockBuddy *b = m->livres[k];
+        while (m->adiados[k] > 0) {
+            if (!b->adiado) {
+                b = b->next_livre;
+                continue;
+            }
+            RemoveLivre(m, b);
+            PushLivre(m, FundeBlock(m, b));
+            b = m->livres[k]; // A fusão pode ter tirado da lista o Block seguinte
+        }
+    }
+}
+
+// ---- Camada slab ----
+void InsereSlab(Slab **lista, Slab *s) {
+    s->ant = NULL;
+    s->prox = *lista;
+    if (*lista) (*lista)->ant = s;
+    *lista = s;
+}
+
+void RetiraSlab(Slab **lista, Slab *s) {
+    if (s->ant) s->ant->prox = s->prox;
+    else *lista = s->prox;
+    if (s->prox) s->prox->ant = s->ant;
+    s->prox = s->ant = NULL;
+}
+
+// Reserva um Block de tam_slab KB e o recorta em objetos da classe. O Block entra como pedido 0:
+// cada objeto soma o seu pedido, então InnerFrag inclui o arredondamento e os objetos ociosos.
+Slab* NovoSlab(MemoriaBuddy *m, int c) {
+    BlockBuddy *b = ReservaBlock(m, m->tam_slab);
+    if (b == NULL) return NULL;
+    ClasseSlab *cl = &m->classes[c];
+    size_t bytes = sizeof(Slab) + (size_t)cl->objetos_por_slab * sizeof(ObjetoSlab);
+    Slab *s = malloc(bytes);
+    if (s == NULL) {
+        perror("Erro ao alocar o slab");
         exit(EXIT_FAILURE);
     }
-    novo->id = id;
-    novo->tam = tam;
-    novo->end_ini = end_ini;
-    novo->alocado = alocado;
-    novo->prox = NULL;
-    novo->ant = NULL;
-    return novo;
+    m->pedido -= m->tam_slab;
+    b->tam_pedido = 0;
+    b->pid = ID_SLAB;
+    s->block = b;
+    s->classe = c;
+    s->em_uso = 0;
+    s->livres = NULL;
+    for (int i = cl->objetos_por_slab - 1; i >= 0; i--) { // O primeiro objeto fica no topo
+        s->objetos[i].slab = s;
+        s->objetos[i].prox_livre = s->livres;
+        s->livres = &s->objetos[i];
+    }
+    cl->slabs++;
+    cl->vazios++;
+    InsereSlab(&cl->parciais, s);
+    m->meta_slab += bytes;
+    if (m->meta_slab > m->pico_meta_slab) m->pico_meta_slab = m->meta_slab;
+    LOG("Novo slab de %" PRIu64 " KB para a classe de %" PRIu64 " KB\n", m->tam_slab, tam_classe_slab[c]);
+    return s;
 }
 
-// Inicializa a memória com um único bloco grande e livre
-void iniciar_memoria(int tam_total) {
-    if (tam_total <= 0 || (tam_total & (tam_total - 1)) != 0) {
-        printf("Erro: O tamanho da memoria deve ser uma potencia de dois e positivo.\n");
+// Devolve ao buddy um slab vazio que está na lista de parciais
+void DevolveSlab(MemoriaBuddy *m, Slab *s) {
+    ClasseSlab *cl = &m->classes[s->classe];
+    RetiraSlab(&cl->parciais, s);
+    cl->slabs--;
+    cl->vazios--;
+    m->meta_slab -= sizeof(Slab) + (size_t)cl->objetos_por_slab * sizeof(ObjetoSlab);
+    LiberaBlock(m, s->block);
+    free(s);
+}
+
+// Devolve todos os slabs vazios. Retorna quantos foram devolvidos.
+int EncolheSlabs(MemoriaBuddy *m) {
+    int devolvidos = 0;
+    for (int c = 0; c < CLASSES_SLAB && m->usar_slab; c++) {
+        Slab *s = m->classes[c].parciais;
+        while (s && m->classes[c].vazios > 0) {
+            Slab *prox = s->prox;
+            if (s->em_uso == 0) {
+                DevolveSlab(m, s);
+                devolvidos++;
+            }
+            s = prox;
+        }
+    }
+    return devolvidos;
+}
+
+// Objeto da classe de tam_req: o primeiro livre do primeiro slab parcial, ou de um slab novo.
+// Retorna NULL se não há espaço para um slab novo (o pedido ainda pode caber num Block menor).
+ObjetoSlab* ReservaObjeto(MemoriaBuddy *m, uint64_t tam_req) {
+    int c = classe_do_tam[tam_req];
+    ClasseSlab *cl = &m->classes[c];
+    cl->pedidos++;
+    m->cont.visitados++;
+    Slab *s = cl->parciais;
+    if (s) {
+        cl->acertos++;
+    } else {
+        s = NovoSlab(m, c);
+        if (s == NULL && EncolheSlabs(m) > 0) s = NovoSlab(m, c); // Slabs vazios de outras classes
+        if (s == NULL) return NULL;
+    }
+
+    ObjetoSlab *obj = s->livres;
+    s->livres = obj->prox_livre;
+    if (s->em_uso++ == 0) cl->vazios--;
+    if (s->livres == NULL) {
+        RetiraSlab(&cl->parciais, s);
+        InsereSlab(&cl->cheios, s);
+    }
+    obj->tam_pedido = tam_req;
+    s->block->tam_pedido += tam_req;
+    m->pedido += tam_req;
+    cl->em_uso++;
+    cl->frag_interna += tam_classe_slab[c] - tam_req;
+    return obj;
+}
+
+void LiberaObjeto(MemoriaBuddy *m, ObjetoSlab *obj) {
+    Slab *s = obj->slab;
+    ClasseSlab *cl = &m->classes[s->classe];
+    s->block->tam_pedido -= obj->tam_pedido;
+    m->pedido -= obj->tam_pedido;
+    cl->em_uso--;
+    cl->frag_interna -= tam_classe_slab[s->classe] - obj->tam_pedido;
+
+    if (s->livres == NULL) {
+        RetiraSlab(&cl->cheios, s);
+        InsereSlab(&cl->parciais, s);
+    }
+    obj->prox_livre = s->livres;
+    s->livres = obj;
+    if (--s->em_uso == 0 && ++cl->vazios > VAZIOS_SLAB) DevolveSlab(m, s);
+}
+
+// Libera memória associada a um processo e tenta juntar Blocks
+void FreeBlock(MemoriaBuddy *m, uint32_t pid)
+{
+    void *atual = tabela_buscar(&m->indice, pid); // Block (ou objeto de slab) do processo em O(1)
+    if (!atual) return;
+    tabela_remover(&m->indice, pid, atual);
+    m->cont.liberacoes++;
+    if ((uintptr_t)atual & 1) LiberaObjeto(m, (ObjetoSlab *)((uintptr_t)atual - 1));
+    else LiberaBlock(m, atual);
+}
+
+// Calcula fragmentação interna
+uint64_t InnerFrag(MemoriaBuddy *m) {
+    return m->ocupado - m->pedido; // Diferença entre tamanho alocado e o das requisições, mantida a cada Alloc/Free
+}
+
+// Linhas da tabela de Blocks (também usadas pelo Buddy em árvore implícita)
+void CabecalhoBuddy() {
+    printf("-----------------------------------------------------------------------\n");
+    printf("Path:                        Size:      Allocated (PID): Int. Frag.\n");
+    printf("-----------------------------------------------------------------------\n");
+}
+
+void LinhaBuddy(const char *path, uint64_t tam, bool alocado, uint64_t tam_pedido, uint32_t pid) {
+    char size_str[32];
+    snprintf(size_str, sizeof(size_str), "%" PRIu64 " KB", tam);
+
+    char alloc_str[112] = "-";
+    char frag_str[32] = "-";
+
+    if (alocado) {
+        snprintf(alloc_str, sizeof(alloc_str), "%" PRIu64 " KB (%s)", tam_pedido,
+                 pid == ID_SLAB ? "slab" : nome_processo(pid));
+        snprintf(frag_str, sizeof(frag_str), "%" PRIu64 " KB", tam - tam_pedido);
+    }
+
+    printf("%-27s %-10s %-17s %s\n", path, size_str, alloc_str, frag_str);
+}
+
+void RodapeBuddy(uint64_t total_memory, uint64_t total_allocated, uint64_t total_frag) {
+    printf("-----------------------------------------------------------------------\n");
+    printf("Total                       %3" PRIu64 " KB      %3" PRIu64 " KB           %" PRIu64 " KB\n", total_memory, total_allocated, total_frag);
+    printf("-----------------------------------------------------------------------\n");
+    printf("\n\n");
+}
+
+void PrintBuddy(MemoriaBuddy *m) {
+    CabecalhoBuddy();
+
+    BlockBuddy* current = m->head;
+
+    // O caminho mais longo vai da raiz até um Block da ordem mínima
+    int max_depth = OrdemTeto(m->tam) - m->ordem_minima;
+    if (max_depth < 0) max_depth = 0;
+    bool rev[max_depth + 1];                    // Caminho inverso do bloco (true = esquerda)
+    size_t tam_path = (size_t)max_depth * 28 + 1; // Cada trecho tem no máximo "18446744073709551616L -> "
+    char *path = malloc(tam_path);
+    if (path == NULL) {
+        perror("Erro ao alocar o caminho do Block");
         exit(EXIT_FAILURE);
     }
-    primeiro = criar_bloco(' ', tam_total, 0, false);
-    primeiro->prox = primeiro; // Lista circular
-    primeiro->ant = primeiro;  // Lista duplamente encadeada e circular
-    ultimo_alocado = primeiro;    // Começa a busca do início
-    printf("Memoria inicializada com %d KB.\n", tam_total);
+
+    while (current) {
+        // Path: e.g., 128L -> 64L -> 32L
+        uint64_t path_start = current->inicio;
+        uint64_t path_size = current->tam;
+        int depth = 0;         // Profundidade do bloco na árvore
+
+        while (path_size < m->tam && depth < max_depth)
+        {
+            uint64_t parent_size = path_size * 2;
+            bool is_left = (path_start % parent_size == 0);
+            rev[depth++] = is_left;
+            path_size = parent_size;
+            if (!is_left) {
+                path_start = path_start - path_size / 2;
+            }
+        }
+
+        // Mostra caminho do bloco raiz -> bloco alocado
+        uint64_t tmp_size = m->tam;
+        size_t len = 0;
+        path[0] = '\0';
+        for (int i = depth - 1; i >= 0; i--) {
+            tmp_size /= 2;
+            len += snprintf(path + len, tam_path - len, "%" PRIu64 "%s%s",
+                            tmp_size, rev[i] ? "L" : "R", i > 0 ? " -> " : "");
+        }
+
+        LinhaBuddy(path, current->tam, !current->status, current->tam_pedido, current->pid);
+        current = current->next;
+    }
+    free(path);
+
+    RodapeBuddy(m->tam, m->pedido, InnerFrag(m));
 }
 
-void mostrar_memoria() {
-    printf("\n--- Estado da Memoria ---\n");
-    if (primeiro == NULL) {
-        printf("Memoria vazia.\n");
-        return;
+
+// Repete a requisição na réplica com fusão imediata, sem nada na saída
+void EspelhaImediato(MemoriaBuddy *r, Requisicao *req) {
+    bool silencioso = modo_silencioso;
+    if (!silencioso) modo_silencioso = true;
+    if (req->op == REQ_IN) AllocBlock(r, req->id, req->tam);
+    else FreeBlock(r, req->id);
+    if (!silencioso) modo_silencioso = false;
+}
+
+// Executa uma requisição lida da entrada
+void execBuddy(MemoriaBuddy* m, Requisicao* req) {
+    iniciar_requisicao(&m->cont, req->op);
+    if (req->op == REQ_IN) {
+        LOG("> Requisicao: IN(%s, %" PRIu64 ")\n", nome_processo(req->id), req->tam);
+        AllocBlock(m, req->id, req->tam);
+    } else {
+        LOG("> Requisicao: OUT(%s)\n", nome_processo(req->id));
+        FreeBlock(m, req->id);
     }
+    bool mostrar = deve_mostrar_estado(&m->cont);
+    if (m->imediato) EspelhaImediato(m->imediato, req); // Depois do registro: a réplica não entra nos histogramas
+    if (mostrar) PrintBuddy(m);
+}
 
-    Bloco *atual = primeiro;
-    printf("|");
-    do {
-        printf(" %d KB ", atual->tam);
-        if (atual->alocado) {
-            printf("(Proc %c) ", atual->id);
+void executar_buddy(void *contexto, Requisicao* req) {
+    execBuddy(contexto, req);
+}
+
+// Ocupação atual em O(1): o maior livre é a maior ordem no mapa de listas livres
+void FragBuddy(MemoriaBuddy *m, Fragmentacao *f) {
+    f->livre = m->tam - m->ocupado;
+    f->maior_livre = m->mapa_ordens ? 1ull << (63 - __builtin_clzll(m->mapa_ordens)) : 0;
+    f->blocos_livres = m->qtd_livres;
+    f->frag_interna = InnerFrag(m);
+}
+
+void ResumoBuddy(MemoriaBuddy *m, Resumo *r) {
+    Fragmentacao f;
+    FragBuddy(m, &f);
+    iniciar_resumo(r, "buddy", m->tam, &m->cont, &f);
+    r->nos = m->pool.em_uso; // Cada Block da lista é um nó do pool
+    r->fusoes_adiadas = m->fusoes_adiadas;
+    r->descarregamentos = m->descarregamentos;
+    if (m->imediato) {
+        r->divisoes_evitadas = m->imediato->divisoes - m->divisoes;
+        r->fusoes_evitadas = m->imediato->fusoes - m->fusoes;
+    }
+    r->pico_nos = m->pool.pico;
+    r->chamadas_evitadas = m->pool.pedidos - m->pool.chamadas;
+}
+
+// Pico de memória de controle em bytes: nós BlockBuddy, índice e descritores de slab
+uint64_t MetadadosBuddy(MemoriaBuddy *m) {
+    return (uint64_t)m->pool.pico * m->pool.tam_no + (uint64_t)m->indice.capacidade * sizeof(EntradaPid)
+           + m->pico_meta_slab;
+}
+
+// Relatório por classe da camada slab, depois do resumo do buddy (texto ou JSON)
+void ImprimeSlab(MemoriaBuddy *m) {
+    if (formato_saida == SAIDA_CSV) return; // O CSV continua com uma linha por execução
+    if (formato_saida == SAIDA_JSON) printf("{\"tam_slab_kb\": %" PRIu64 ", \"classes\": [", m->tam_slab);
+    else {
+        printf("\n--- Camada slab (slabs de %" PRIu64 " KB) ---\n", m->tam_slab);
+        printf("%-8s %-6s %-9s %-9s %-9s %-11s %s\n", "Classe", "Slabs", "Objetos", "Em uso", "Pedidos",
+               "Acertos (%)", "Frag. interna");
+    }
+    for (int c = 0; c < CLASSES_SLAB; c++) {
+        ClasseSlab *cl = &m->classes[c];
+        double taxa = cl->pedidos ? 100.0 * cl->acertos / cl->pedidos : 0.0;
+        if (formato_saida == SAIDA_JSON) {
+            printf("%s{\"classe_kb\": %" PRIu64 ", \"slabs\": %d, \"objetos_por_slab\": %d, \"em_uso\": %ld, "
+                   "\"pedidos\": %ld, \"acertos\": %ld, \"taxa_acerto\": %.2f, \"frag_interna_kb\": %" PRIu64 "}",
+                   c ? ", " : "", tam_classe_slab[c], cl->slabs, cl->objetos_por_slab, cl->em_uso,
+                   cl->pedidos, cl->acertos, taxa, cl->frag_interna);
         } else {
-            printf("(Livre) ");
+            char classe[16];
+            snprintf(classe, sizeof(classe), "%" PRIu64 " KB", tam_classe_slab[c]);
+            printf("%-8s %-6d %-9d %-9ld %-9ld %-11.2f %" PRIu64 " KB\n", classe, cl->slabs, cl->objetos_por_slab,
+                   cl->em_uso, cl->pedidos, taxa, cl->frag_interna);
         }
-        printf("End: %d |", atual->end_ini);
-        atual = atual->prox;
-    } while (atual != primeiro); // Percorre toda a lista circular
+    }
+    if (formato_saida == SAIDA_JSON) printf("]}\n");
+}
 
-    printf("\n");
-    printf("-------------------------\n");
+void amostrar_buddy(void *contexto, Fragmentacao *f) {
+    FragBuddy(contexto, f);
+}
+
+// Instantâneo da instância (sem slab e sem modo preguiçoso): os Blocks em ordem de endereço e as listas livres
+// de cada ordem do início ao fim, para que os próximos pedidos peguem os mesmos Blocks
+void CapturaBuddy(void *contexto, Instantaneo *s) {
+    MemoriaBuddy *m = contexto;
+    uint64_t qtd_blocos = 0;
+    for (BlockBuddy *b = m->head; b; b = b->next) qtd_blocos++;
+    instantaneo_reservar(s, qtd_blocos, m->qtd_livres, m->indice.ocupadas);
+
+    uint64_t i = 0;
+    for (BlockBuddy *b = m->head; b; b = b->next, i++) {
+        s->blocos[i].inicio = b->inicio;
+        s->blocos[i].tam = b->tam;
+        s->blocos[i].tam_pedido = b->tam_pedido;
+        s->blocos[i].pid = b->pid;
+        s->blocos[i].alocado = !b->status;
+        s->blocos[i].adiado = b->adiado;
+        s->blocos[i].lado = b->lado;
+    }
+    i = 0;
+    for (int k = 0; k < MAX_ORDEM_BUDDY; k++) {
+        for (BlockBuddy *b = m->livres[k]; b; b = b->next_livre) s->livres[i++] = b->inicio;
+    }
+    capturar_indice(s, &m->indice, offsetof(BlockBuddy, inicio));
+
+    instantaneo_contadores(s, &m->cont);
+    s->cab.tam_mem = m->tam;
+    s->cab.ordem_minima = m->ordem_minima;
+    s->cab.totais[0] = m->divisoes;
+    s->cab.totais[1] = m->fusoes;
+}
+
+bool RestauraBuddy(void *contexto, const Instantaneo *s) {
+    MemoriaBuddy *m = contexto;
+    if (s->cab.ordem_minima != m->ordem_minima) {
+        fprintf(stderr, "O instantaneo usa ordem minima %d\n", s->cab.ordem_minima);
+        return false;
+    }
+    pool_resetar(&m->pool);
+    tabela_limpar(&m->indice);
+    memset(m->livres, 0, sizeof(m->livres));
+    m->mapa_ordens = 0;
+    m->qtd_livres = 0;
+    m->ocupado = m->pedido = 0;
+
+    BlockBuddy **nos = malloc(s->cab.qtd_blocos * sizeof(BlockBuddy *));
+    if (nos == NULL) {
+        perror("Erro ao alocar os Blocks restaurados");
+        exit(EXIT_FAILURE);
+    }
+    bool ok = true;
+    for (uint64_t i = 0; i < s->cab.qtd_blocos; i++) {
+        const RegistroBloco *r = &s->blocos[i];
+        BlockBuddy *Block = nos[i] = pool_alocar(&m->pool);
+        Block->inicio = r->inicio;
+        Block->tam = r->tam;
+        Block->status = !r->alocado;
+        Block->pid = r->alocado ? r->pid : ID_LIVRE;
+        Block->tam_pedido = r->alocado ? r->tam_pedido : 0;
+        Block->lado = r->lado;
+        Block->adiado = false;
+        Block->ordem = OrdemTeto(r->tam);
+        Block->prev = i ? nos[i - 1] : NULL;
+        Block->next = NULL;
+        Block->next_livre = Block->prev_livre = NULL;
+        if (i) nos[i - 1]->next = Block;
+        else m->head = Block;
+        if (r->alocado) {
+            m->ocupado += r->tam;
+            m->pedido += r->tam_pedido;
+        }
+        // Só Blocks de potência de 2, alinhados ao próprio tamanho e sem fusão pendente
+        if ((r->tam & (r->tam - 1)) != 0 || r->inicio % r->tam != 0 || Block->ordem < m->ordem_minima || r->adiado)
+            ok = false;
+    }
+
+    ok = ok && restaurar_indice(&m->indice, s, (void **)nos);
+    for (uint64_t j = s->cab.qtd_livres; ok && j-- > 0;) { // PushLivre insere no início da lista
+        long i = registro_do_endereco(s, s->livres[j]);
+        ok = i >= 0 && nos[i]->status && m->livres[nos[i]->ordem] != nos[i] && nos[i]->prev_livre == NULL;
+        if (ok) PushLivre(m, nos[i]);
+    }
+    free(nos);
+
+    restaurar_contadores(&m->cont, s);
+    m->divisoes = s->cab.totais[0];
+    m->fusoes = s->cab.totais[1];
+    return ok;
+}
+
+const OperacoesEstado estado_buddy = {CapturaBuddy, RestauraBuddy};
+
+// Roda o particionamento buddy. Retorna 0, ou -1 se o arquivo não pôde ser aberto.
+int Runbuddy(uint64_t tam_mem, const char *nome_arquivo) {
+    MemoriaBuddy memoria;
+    InitBlock(&memoria, tam_mem);
+    instrumentacao_iniciar(&memoria.cont, "buddy");
+
+    int status = processar_com_serie(nome_arquivo, executar_buddy, &memoria, amostrar_buddy, &memoria.cont,
+                                     POLITICA_BUDDY, "buddy", tam_mem, &estado_buddy);
+    if (status == 0) {
+        Resumo r;
+        ResumoBuddy(&memoria, &r);
+        imprimir_resumo(&r);
+        if (memoria.usar_slab) ImprimeSlab(&memoria);
+    }
+
+    instrumentacao_finalizar(&memoria.cont);
+    DestroyBuddy(&memoria);
+    return status;
+}
+
+// ------------- BUDDY (arvore implicita) -------------------
+// Alternativa ao Buddy em lista, no estilo "buddy2": a árvore completa fica num vetor de 2N-1 bytes,
+// onde N é o número de folhas de 2^ordem_minima KB. O nó i tem filhos 2i+1 e 2i+2 e guarda
+// 1 + a maior ordem livre da sua subárvore, contada a partir da ordem mínima (0 = nada livre).
+// Não há nós por Block: o caminho e o endereço de um Block saem do próprio índice do nó.
+#define MAX_FOLHAS_ARVORE (1ull << 26)
+#define NO_INVALIDO SIZE_MAX
+
+typedef struct ArvoreBuddy {
+    uint8_t *nos;
+    int ordem_raiz;             // log2(N)
+    int ordem_minima;
+    uint64_t tam;               // Tamanho total (KB)
+    uint64_t ocupado;           // KB em Blocks alocados
+    uint64_t pedido;            // KB pedidos pelos processos desses Blocks
+    int qtd_livres;             // Blocks livres (nós livres cujo pai não está livre)
+    int qtd_alocados;
+    uint32_t *pid_folha;        // Processo do Block alocado que começa em cada folha
+    uint64_t *pedido_folha;     // Tamanho pedido por esse processo
+    TabelaPid indice;           // PID -> nó + 1
+    Contadores cont;
+} ArvoreBuddy;
+
+// Nível do nó (0 = raiz)
+int NivelNo(size_t no) {
+    return 63 - __builtin_clzll(no + 1);
+}
+
+// Ordem dos Blocks no nível do nó, relativa à ordem mínima
+int OrdemNo(ArvoreBuddy *a, size_t no) {
+    return a->ordem_raiz - NivelNo(no);
+}
+
+// Primeira folha coberta pelo nó
+uint64_t FolhaNo(ArvoreBuddy *a, size_t no) {
+    int nivel = NivelNo(no);
+    return ((uint64_t)(no + 1) - (1ull << nivel)) << (a->ordem_raiz - nivel);
+}
+
+uint64_t TamNo(ArvoreBuddy *a, size_t no) {
+    return 1ull << (OrdemNo(a, no) + a->ordem_minima);
+}
+
+bool NoLivre(ArvoreBuddy *a, size_t no) {
+    return a->nos[no] == OrdemNo(a, no) + 1;
+}
+
+// Um nó alocado vale 0 e continua com os filhos inteiramente livres; um nó esgotado pelos filhos não
+bool NoAlocado(ArvoreBuddy *a, size_t no) {
+    return a->nos[no] == 0 && (OrdemNo(a, no) == 0 || NoLivre(a, 2 * no + 1));
+}
+
+// Recalcula os ancestrais do nó: dois filhos livres se juntam no pai. Retorna quantas fusões houve.
+int AtualizaAncestrais(ArvoreBuddy *a, size_t no) {
+    int fusoes = 0;
+    while (no > 0) {
+        no = (no - 1) / 2;
+        uint8_t esq = a->nos[2 * no + 1];
+        uint8_t dir = a->nos[2 * no + 2];
+        int k = OrdemNo(a, no);
+        a->cont.visitados++;
+        if (esq == k && dir == k) {
+            a->nos[no] = k + 1;
+            fusoes++;
+        } else {
+            a->nos[no] = esq > dir ? esq : dir;
+        }
+    }
+    a->cont.fusoes += fusoes;
+    return fusoes;
+}
+
+// Próximo Block (nó livre ou alocado) em ordem de endereço, ou NO_INVALIDO no fim
+size_t ProximoBlocoArvore(ArvoreBuddy *a, size_t no) {
+    while (no > 0 && no % 2 == 0) no = (no - 1) / 2; // Sobe enquanto for filho direito
+    if (no == 0) return NO_INVALIDO;
+    no++; // Irmão direito
+    while (!NoLivre(a, no) && !NoAlocado(a, no)) no = 2 * no + 1;
+    return no;
+}
+
+size_t PrimeiroBlocoArvore(ArvoreBuddy *a) {
+    size_t no = 0;
+    while (!NoLivre(a, no) && !NoAlocado(a, no)) no = 2 * no + 1;
+    return no;
+}
+
+// Cria a árvore com a memória inteira livre. Retorna false se a árvore seria grande demais.
+bool InitArvore(ArvoreBuddy *a, uint64_t tam_total) {
+    memset(a, 0, sizeof(ArvoreBuddy));
+    uint64_t folhas = tam_total >> ordem_minima;
+    if (folhas > MAX_FOLHAS_ARVORE) {
+        fprintf(stderr, "Erro: A arvore implicita teria %" PRIu64 " folhas (maximo %llu); aumente --ordem-minima.\n",
+                folhas, MAX_FOLHAS_ARVORE);
+        return false;
+    }
+    a->tam = tam_total;
+    a->ordem_minima = ordem_minima;
+    a->ordem_raiz = OrdemTeto(folhas);
+    a->nos = malloc(2 * folhas - 1);
+    a->pid_folha = calloc(folhas, sizeof(uint32_t));
+    a->pedido_folha = calloc(folhas, sizeof(uint64_t));
+    if (a->nos == NULL || a->pid_folha == NULL || a->pedido_folha == NULL) {
+        perror("Erro ao alocar a arvore do buddy");
+        exit(EXIT_FAILURE);
+    }
+    // Cada nível é um trecho contíguo do vetor
+    for (int nivel = 0; nivel <= a->ordem_raiz; nivel++) {
+        memset(a->nos + (1ull << nivel) - 1, a->ordem_raiz - nivel + 1, 1ull << nivel);
+    }
+    a->qtd_livres = 1;
+    tabela_iniciar(&a->indice, 64);
+    return true;
+}
+
+void DestroyArvore(ArvoreBuddy *a) {
+    free(a->nos);
+    free(a->pid_folha);
+    free(a->pedido_folha);
+    a->nos = NULL;
+    a->pid_folha = NULL;
+    a->pedido_folha = NULL;
+    tabela_limpar(&a->indice);
+}
+
+// Reserva um Block descendo da raiz em O(log N): a cada nível, o filho que comporta o pedido com a menor sobra
+// (o da esquerda no empate). Diferente do Buddy em lista, que usa a menor ordem livre e o Block liberado por
+// último nela, a árvore só conhece a maior ordem de cada subárvore: com Blocks da mesma ordem dos dois lados,
+// o escolhido pode ser outro. Retorna o nó, ou NO_INVALIDO se não há espaço.
+size_t ReservaNo(ArvoreBuddy *a, uint64_t tam_req) {
+    int k = OrdemTeto(tam_req) - a->ordem_minima;
+    if (k < 0) k = 0;
+    if (k > a->ordem_raiz || a->nos[0] <= k) return NO_INVALIDO;
+
+    size_t no = 0;
+    int divisoes = 0;
+    while (OrdemNo(a, no) > k) {
+        a->cont.visitados++;
+        if (NoLivre(a, no)) {
+            divisoes++;
+            LOG("Dividindo Block de %" PRIu64 " KB em %" PRIu64 " L e %" PRIu64 " R\n",
+                TamNo(a, no), TamNo(a, no) / 2, TamNo(a, no) / 2);
+        }
+        size_t esq = 2 * no + 1;
+        size_t dir = esq + 1;
+        if (a->nos[esq] > k && (a->nos[dir] <= k || a->nos[esq] <= a->nos[dir])) no = esq;
+        else no = dir;
+    }
+
+    a->nos[no] = 0;
+    AtualizaAncestrais(a, no);
+    a->pedido_folha[FolhaNo(a, no)] = tam_req;
+    a->cont.divisoes += divisoes;
+    a->qtd_livres += divisoes - 1; // Sai o Block livre escolhido, entra uma metade livre por divisão
+    a->qtd_alocados++;
+    a->ocupado += TamNo(a, no);
+    a->pedido += tam_req;
+    return no;
+}
+
+void LiberaNo(ArvoreBuddy *a, size_t no) {
+    a->ocupado -= TamNo(a, no);
+    a->pedido -= a->pedido_folha[FolhaNo(a, no)];
+    a->qtd_alocados--;
+    a->nos[no] = OrdemNo(a, no) + 1;
+    a->qtd_livres += 1 - AtualizaAncestrais(a, no); // Cada fusão junta dois Blocks livres em um
+}
+
+int AllocArvore(ArvoreBuddy *a, uint32_t pid, uint64_t tam_req) {
+    size_t no = ReservaNo(a, tam_req);
+    if (no == NO_INVALIDO) {
+        LOG("ESPACO INSUFICIENTE DE MEMORIA\n");
+        a->cont.falhas++;
+        return -1;
+    }
+    a->pid_folha[FolhaNo(a, no)] = pid;
+    tabela_inserir(&a->indice, pid, (void *)(uintptr_t)(no + 1)); // +1: o valor NULL marca posição vazia
+    a->cont.alocacoes++;
+    LOG("> Alocando %s com tamanho %" PRIu64 " para Block [%" PRIu64 " %c]\n",
+        nome_processo(pid), tam_req, TamNo(a, no), no == 0 ? '-' : (no % 2 ? 'L' : 'R'));
+    return 0;
+}
 
-    printf("\n--- Blocos Livres Contiguos ---\n");
-    Bloco *p_atual = primeiro;
-    int contador_contiguos_livres = 0; // Para contar o número de sequências contíguas de blocos livres
+void FreeArvore(ArvoreBuddy *a, uint32_t pid) {
+    void *valor = tabela_buscar(&a->indice, pid);
+    if (!valor) return;
+    tabela_remover(&a->indice, pid, valor);
+    a->cont.liberacoes++;
+    LiberaNo(a, (uintptr_t)valor - 1);
+}
 
-    do {
-        if (!p_atual->alocado) {
-            // Encontrou o início de um bloco livre ou continuação de uma sequência
-            Bloco *inicio_sequencia = p_atual;
-            int tamanho_total_sequencia = 0;
-            int num_blocos_na_sequencia = 0;
-
-            // Percorre a sequência de blocos livres
-            Bloco *temp = inicio_sequencia;
-            do {
-                if (!temp->alocado) {
-                    tamanho_total_sequencia += temp->tam;
-                    num_blocos_na_sequencia++;
-                    temp = temp->prox;
-                } else {
-                    break; // A sequência de blocos livres terminou
-                }
-            } while (temp != primeiro && temp != inicio_sequencia); // Evita loop infinito em caso de memória totalmente livre
+// Mesma tabela do PrintBuddy; o caminho é lido direto dos bits do índice do nó
+void PrintArvore(ArvoreBuddy *a) {
+    CabecalhoBuddy();
 
-            // Se a sequência de blocos livres existe
-            if (num_blocos_na_sequencia > 0) {
-                contador_contiguos_livres++;
-                printf("Sequencia %d: %d KB livres (comeca em End: %d)\n", 
-                       contador_contiguos_livres, tamanho_total_sequencia, inicio_sequencia->end_ini);
-            }
-            
-            // Avança o ponteiro principal para o final da sequência já processada,para não repetir blocos
-            p_atual = temp; 
+    size_t tam_path = (size_t)a->ordem_raiz * 28 + 1;
+    char *path = malloc(tam_path);
+    if (path == NULL) {
+        perror("Erro ao alocar o caminho do Block");
+        exit(EXIT_FAILURE);
+    }
 
-        } else {
-            p_atual = p_atual->prox;
+    for (size_t no = PrimeiroBlocoArvore(a); no != NO_INVALIDO; no = ProximoBlocoArvore(a, no)) {
+        // Abaixo do 1 mais alto de no + 1, cada bit é um passo: 0 = esquerda, 1 = direita
+        int nivel = NivelNo(no);
+        size_t len = 0;
+        path[0] = '\0';
+        for (int i = nivel - 1; i >= 0; i--) {
+            len += snprintf(path + len, tam_path - len, "%" PRIu64 "%s%s", a->tam >> (nivel - i),
+                            ((no + 1) >> i) & 1 ? "R" : "L", i > 0 ? " -> " : "");
         }
-    } while (p_atual != primeiro);
 
-    if (contador_contiguos_livres == 0) {
-        printf("Nenhum bloco livre contiguo encontrado.\n");
+        uint64_t folha = FolhaNo(a, no);
+        LinhaBuddy(path, TamNo(a, no), NoAlocado(a, no), a->pedido_folha[folha], a->pid_folha[folha]);
     }
-    printf("-----------------------------------\n");
-}
+    free(path);
 
-// Aloca memória usando a política Circular-Fit
-void alocar_memoria_circular(char id_proc, int tam_req) {
-    printf("\nRequisicao: IN(%c, %d)\n", id_proc,tam_req);
+    RodapeBuddy(a->tam, a->pedido, a->ocupado - a->pedido);
+}
 
-    if (primeiro == NULL) {
-        printf("Erro: Memoria nao inicializada.\n");
-        return;
+void executar_arvore(void *contexto, Requisicao* req) {
+    ArvoreBuddy *a = contexto;
+    iniciar_requisicao(&a->cont, req->op);
+    if (req->op == REQ_IN) {
+        LOG("> Requisicao: IN(%s, %" PRIu64 ")\n", nome_processo(req->id), req->tam);
+        AllocArvore(a, req->id, req->tam);
+    } else {
+        LOG("> Requisicao: OUT(%s)\n", nome_processo(req->id));
+        FreeArvore(a, req->id);
     }
+    if (deve_mostrar_estado(&a->cont)) PrintArvore(a);
+}
 
-    Bloco *busca_atual = ultimo_alocado;
-    Bloco *bloco_encontrado = NULL;
-    int nos_verificados = 0;
-    int total_nos = 0;
+// Ocupação atual em O(1): o maior livre sai da raiz
+void FragArvore(ArvoreBuddy *a, Fragmentacao *f) {
+    f->livre = a->tam - a->ocupado;
+    f->maior_livre = a->nos[0] ? 1ull << (a->nos[0] - 1 + a->ordem_minima) : 0;
+    f->blocos_livres = a->qtd_livres;
+    f->frag_interna = a->ocupado - a->pedido;
+}
 
-    // Contar o número total de nós para o loop de segurança
-    Bloco *temp = primeiro;
-    if (temp != NULL) {
-        do {
-            total_nos++;
-            temp = temp->prox;
-        } while (temp != primeiro);
-    }
+void ResumoArvore(ArvoreBuddy *a, Resumo *r) {
+    Fragmentacao f;
+    FragArvore(a, &f);
+    iniciar_resumo(r, "buddy2", a->tam, &a->cont, &f);
+    r->nos = a->qtd_alocados + a->qtd_livres;
+}
 
-     // Loop para procurar a partir do último bloco alocado, circulando
-    while (nos_verificados < total_nos) {
-        if (!busca_atual->alocado && busca_atual->tam >= tam_req) {
-            bloco_encontrado = busca_atual;
-            break; // Encontrou o primeiro bloco adequado
-        }
-        busca_atual = busca_atual->prox;
-        nos_verificados++;
+// Memória de controle em bytes: vetor de nós e dados por folha (fixos) mais o índice
+uint64_t MetadadosArvore(ArvoreBuddy *a) {
+    uint64_t folhas = a->tam >> a->ordem_minima;
+    return (2 * folhas - 1) + folhas * (sizeof(uint32_t) + sizeof(uint64_t))
+           + (uint64_t)a->indice.capacidade * sizeof(EntradaPid);
+}
+
+void amostrar_arvore(void *contexto, Fragmentacao *f) {
+    FragArvore(contexto, f);
+}
+
+// Roda o buddy em árvore implícita. Retorna 0, ou -1 se o arquivo não pôde ser aberto ou a árvore não cabe.
+int Runbuddy2(uint64_t tam_mem, const char *nome_arquivo) {
+    ArvoreBuddy arvore;
+    if (!InitArvore(&arvore, tam_mem)) return -1;
+    instrumentacao_iniciar(&arvore.cont, "buddy2");
+
+    int status = processar_com_serie(nome_arquivo, executar_arvore, &arvore, amostrar_arvore, &arvore.cont,
+                                     POLITICA_BUDDY2, "buddy2", tam_mem, NULL);
+    if (status == 0) {
+        Resumo r;
+        ResumoArvore(&arvore, &r);
+        imprimir_resumo(&r);
     }
 
-    if (bloco_encontrado != NULL) {
-        if (bloco_encontrado->tam == tam_req) {
-            // Encaixe perfeito
-            bloco_encontrado->id = id_proc;
-            bloco_encontrado->alocado = true;
-            printf("Alocado %d KB para o processo %c (encaixe perfeito).\n", tam_req, id_proc);
-        } else {
-            // Divide o bloco existente
-            Bloco *novo_bloco_livre = criar_bloco(
-                ' ',
-                bloco_encontrado->tam - tam_req,
-                bloco_encontrado->end_ini + tam_req,
-                false
-            );
-
-            // Insere o novo bloco livre APÓS o bloco alocado
-            novo_bloco_livre->prox = bloco_encontrado->prox;
-            novo_bloco_livre->ant = bloco_encontrado;
-            if (bloco_encontrado->prox != NULL) {
-                bloco_encontrado->prox->ant = novo_bloco_livre;
-            }
-            bloco_encontrado->prox = novo_bloco_livre;
+    instrumentacao_finalizar(&arvore.cont);
+    DestroyArvore(&arvore);
+    return status;
+}
 
-            // Atualiza o bloco original (agora alocado)
-            bloco_encontrado->id = id_proc;
-            bloco_encontrado->tam = tam_req;
-            bloco_encontrado->alocado = true;
+// ------------- Execucao concorrente -------------------
+// Replay do trace por várias threads sobre uma arena global (uma instância de qualquer política)
+// protegida por uma trava. Cada thread guarda os Blocks que liberou em caches por classe de tamanho
+// (potências de 2) e só toma a trava quando o cache da classe está vazio ou cheio. O particionamento
+// variável reserva o tamanho pedido, como na execução serial; a classe só escolhe o cache, de onde sai
+// um bloco que comporte o pedido.
+// As requisições são repartidas pelo PID, então IN e OUT de um processo ficam na mesma thread.
+#define CACHE_POR_CLASSE 32
 
-            printf("Alocado %d KB para o processo %c (bloco dividido).\n", tam_req, id_proc);
-        }
-        ultimo_alocado = bloco_encontrado; // Atualiza o ponteiro para o último bloco alocado
+typedef struct Arena {
+    int politica;
+    MemoriaVariavel variavel;   // Só a instância da política em uso é iniciada
+    MemoriaBuddy buddy;
+    ArvoreBuddy arvore;
+    int classe_minima;          // Menor classe que a política entrega (a ordem mínima no Buddy)
+    pthread_mutex_t trava;
+    long aquisicoes;            // Vezes que a trava foi tomada
+    long contencoes;            // Vezes em que ela já estava com outra thread
+} Arena;
+
+bool arena_iniciar(Arena *a, int politica, uint64_t tam) {
+    memset(a, 0, sizeof(Arena));
+    a->politica = politica;
+    if (politica == POLITICA_BUDDY) {
+        IniciaBuddy(&a->buddy, tam, max_adiados); // Sem réplica: as arenas não passam por execBuddy
+        a->classe_minima = ordem_minima;
+    } else if (politica == POLITICA_BUDDY2) {
+        if (!InitArvore(&a->arvore, tam)) return false;
+        a->classe_minima = ordem_minima;
     } else {
-        printf("ESPACO INSUFICIENTE DE MEMORIA para o processo %c.\n", id_proc);
+        iniciar_memoria(&a->variavel, politica, tam);
     }
-    mostrar_memoria(); 
+    pthread_mutex_init(&a->trava, NULL);
+    return true;
 }
 
-// Libera memória e tenta juntar blocos livres adjacentes
-void liberar_memoria(char id_proc) {
-    printf("\nRequisicao: OUT(%c)\n", id_proc);
+void arena_destruir(Arena *a) {
+    if (a->politica == POLITICA_BUDDY) DestroyBuddy(&a->buddy);
+    else if (a->politica == POLITICA_BUDDY2) DestroyArvore(&a->arvore);
+    else limpar_memoria(&a->variavel);
+    pthread_mutex_destroy(&a->trava);
+}
 
-    if (primeiro == NULL) {
-        printf("Erro: Memoria nao inicializada.\n");
-        return;
+void arena_travar(Arena *a) {
+    if (pthread_mutex_trylock(&a->trava) != 0) {
+        pthread_mutex_lock(&a->trava);
+        a->contencoes++;
     }
+    a->aquisicoes++;
+}
 
-    Bloco *atual = primeiro;
-    Bloco *bloco_liberado = NULL;
+void arena_destravar(Arena *a) {
+    pthread_mutex_unlock(&a->trava);
+}
 
-    do {
-        if (atual->id == id_proc && atual->alocado) {
-            atual->alocado = false; // Marca como livre
-            atual->id = ' ';        // Limpa o ID do processo
-            bloco_liberado = atual;
-            printf("Memoria liberada para o processo %c.\n", id_proc);
-            break;
-        }
-        atual = atual = atual->prox; // Corrigido: 'atual = atual->prox;'
-    } while (atual != primeiro); // Percorre toda a lista circular
+// Reserva um bloco de tam KB na arena (com a trava tomada). Retorna NULL se não há espaço.
+void* arena_reservar(Arena *a, uint32_t pid, uint64_t tam) {
+    if (a->politica == POLITICA_BUDDY) {
+        BlockBuddy *b = ReservaBlock(&a->buddy, tam);
+        if (b) b->pid = pid;
+        return b;
+    }
+    if (a->politica == POLITICA_BUDDY2) {
+        size_t no = ReservaNo(&a->arvore, tam);
+        return no == NO_INVALIDO ? NULL : (void *)(uintptr_t)(no + 1);
+    }
+    Bloco *b = buscar_variavel(&a->variavel, tam);
+    if (b) ocupar_bloco(&a->variavel, b, pid, tam);
+    return b;
+}
 
-    mostrar_memoria(); // Exibe o status da memória após a liberação
+// Devolve um bloco à arena (com a trava tomada)
+void arena_devolver(Arena *a, void *bloco) {
+    if (a->politica == POLITICA_BUDDY) LiberaBlock(&a->buddy, bloco);
+    else if (a->politica == POLITICA_BUDDY2) LiberaNo(&a->arvore, (uintptr_t)bloco - 1);
+    else liberar_bloco(&a->variavel, bloco);
 }
 
-// Processa requisições de um arquivo
-void processar_requisicoes_arquivo(const char *nome_arquivo) {
-    FILE *arquivo = fopen(nome_arquivo, "r");
-    if (arquivo == NULL) {
-        perror("Erro ao abrir o arquivo de requisicoes");
-        return;
-    }
+// Tamanho de um bloco reservado. Não precisa da trava: ninguém mais mexe no tamanho de um bloco ocupado.
+uint64_t arena_tam_bloco(Arena *a, void *bloco) {
+    if (a->politica == POLITICA_BUDDY) return ((BlockBuddy *)bloco)->tam;
+    if (a->politica == POLITICA_BUDDY2) return TamNo(&a->arvore, (uintptr_t)bloco - 1);
+    return ((Bloco *)bloco)->tam;
+}
+
+typedef struct CacheClasse {
+    void *blocos[CACHE_POR_CLASSE];
+    int qtd;
+} CacheClasse;
 
-    char linha[100];
-    char comando[5];
-    char id_processo;
-    int tamanho;
+typedef struct Trabalhador {
+    pthread_t thread;
+    Arena *arena;
+    Requisicao *reqs;               // Requisições desta thread, na ordem do trace
+    long qtd;
+    TabelaPid blocos;               // PID -> bloco (só desta thread)
+    CacheClasse cache[MAX_ORDEM_BUDDY];
+    long alocacoes;
+    long falhas;
+    long liberacoes;
+    long acertos;                   // INs atendidos pelo cache, sem tomar a trava
+} Trabalhador;
 
-    while (fgets(linha, sizeof(linha), arquivo) != NULL) {
-        linha[strcspn(linha, "\n")] = 0; // Remove o '\n'
+// Devolve à arena os blocos [0, qtd) do cache da classe (com a trava tomada)
+void cache_devolver(Trabalhador *t, CacheClasse *c, int qtd) {
+    for (int i = 0; i < qtd; i++) arena_devolver(t->arena, c->blocos[i]);
+    memmove(c->blocos, c->blocos + qtd, (c->qtd - qtd) * sizeof(void *));
+    c->qtd -= qtd;
+}
 
-        // Requisição IN(ID,TAM)
-        if (sscanf(linha, "IN(%c,%d)", &id_processo, &tamanho) == 2) {
-            alocar_memoria_circular(id_processo, tamanho);
+// Retira do cache o bloco mais recente que comporta tam KB, ou NULL
+void* cache_retirar(Trabalhador *t, CacheClasse *c, uint64_t tam) {
+    for (int i = c->qtd - 1; i >= 0; i--) {
+        void *bloco = c->blocos[i];
+        if (arena_tam_bloco(t->arena, bloco) >= tam) {
+            memmove(c->blocos + i, c->blocos + i + 1, (c->qtd - i - 1) * sizeof(void *)); // Mantém a idade
+            c->qtd--;
+            return bloco;
         }
-        // Requisição OUT(ID)
-        else if (sscanf(linha, "OUT(%c)", &id_processo) == 1) {
-            liberar_memoria(id_processo);
+    }
+    return NULL;
+}
+
+void cache_esvaziar(Trabalhador *t) {
+    for (int k = 0; k < MAX_ORDEM_BUDDY; k++) {
+        if (t->cache[k].qtd > 0) cache_devolver(t, &t->cache[k], t->cache[k].qtd);
+    }
+}
+
+void* executar_trabalhador(void *arg) {
+    Trabalhador *t = arg;
+    Arena *a = t->arena;
+
+    for (long i = 0; i < t->qtd; i++) {
+        Requisicao *req = &t->reqs[i];
+        if (req->op == REQ_IN) {
+            int k = OrdemTeto(req->tam);
+            if (k < a->classe_minima) k = a->classe_minima;
+            bool buddy = a->politica == POLITICA_BUDDY || a->politica == POLITICA_BUDDY2;
+            void *bloco = NULL;
+            if (k < MAX_ORDEM_BUDDY && (bloco = cache_retirar(t, &t->cache[k], req->tam)) != NULL) {
+                t->acertos++;
+            } else if (k < MAX_ORDEM_BUDDY) {
+                uint64_t tam = buddy ? 1ull << k : req->tam;
+                arena_travar(a);
+                bloco = arena_reservar(a, req->id, tam);
+                if (bloco == NULL) {
+                    cache_esvaziar(t); // Blocos parados no cache podem atender o pedido
+                    bloco = arena_reservar(a, req->id, tam);
+                }
+                arena_destravar(a);
+            }
+            if (bloco) {
+                tabela_inserir(&t->blocos, req->id, bloco);
+                t->alocacoes++;
+            } else {
+                t->falhas++;
+            }
         } else {
-            printf("Linha invalida no arquivo: %s\n", linha);
+            void *bloco = tabela_buscar(&t->blocos, req->id);
+            if (bloco == NULL) continue;
+            tabela_remover(&t->blocos, req->id, bloco);
+            t->liberacoes++;
+
+            CacheClasse *c = &t->cache[OrdemTeto(arena_tam_bloco(a, bloco))];
+            if (c->qtd == CACHE_POR_CLASSE) {
+                arena_travar(a);
+                cache_devolver(t, c, CACHE_POR_CLASSE / 2); // Devolve os mais antigos em lote
+                arena_destravar(a);
+            }
+            c->blocos[c->qtd++] = bloco;
         }
     }
 
-    fclose(arquivo);
+    arena_travar(a);
+    cache_esvaziar(t);
+    arena_destravar(a);
+    return NULL;
 }
 
-// Libera toda a memória alocada dinamicamente
-void limpar_memoria() {
-    if (primeiro == NULL) return;
+typedef struct VetorRequisicoes {
+    Requisicao *itens;
+    long qtd;
+    long cap;
+} VetorRequisicoes;
 
-    Bloco *atual = primeiro->prox;
-    Bloco *temp;
+void acumular_requisicao(void *contexto, Requisicao *req) {
+    VetorRequisicoes *v = contexto;
+    if (v->qtd == v->cap) {
+        v->cap = v->cap ? v->cap * 2 : LOTE_REQUISICOES;
+        v->itens = realloc(v->itens, v->cap * sizeof(Requisicao));
+        if (v->itens == NULL) {
+            perror("Erro ao alocar o vetor de requisicoes");
+            exit(EXIT_FAILURE);
+        }
+    }
+    v->itens[v->qtd++] = *req;
+}
 
-    // Quebra a lista circular para liberar corretamente
-    primeiro->ant->prox = NULL; // O último nó não aponta mais para o primeiro
+typedef struct ResultadoConcorrente {
+    int threads;
+    double segundos;
+    long aquisicoes;
+    long contencoes;
+    long acertos;
+    long alocacoes;
+    long falhas;
+    long liberacoes;
+} ResultadoConcorrente;
 
-    while (atual != NULL) { // O loop deve parar quando 'atual' for NULL, ou quando voltar ao 'primeiro' se a quebra falhar.
-        temp = atual;
-        atual = atual->prox;
-        free(temp);
-        if (temp == primeiro) { // Se por algum motivo o primeiro não foi liberado antes (caso de um único bloco)
-            break;
+// Replay com n threads sobre uma arena nova. Retorna false se a arena não pôde ser criada.
+bool medir_concorrente(int politica, uint64_t tam, const VetorRequisicoes *v, int n, ResultadoConcorrente *res) {
+    Arena arena;
+    if (!arena_iniciar(&arena, politica, tam)) return false;
+
+    // Reparte as requisições pelo PID, preservando a ordem dentro de cada thread
+    Trabalhador *ts = calloc(n, sizeof(Trabalhador));
+    if (ts == NULL) {
+        perror("Erro ao alocar as threads");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < v->qtd; i++) ts[hash_pid(v->itens[i].id) % n].qtd++;
+    for (int j = 0; j < n; j++) {
+        ts[j].arena = &arena;
+        ts[j].reqs = malloc((ts[j].qtd + 1) * sizeof(Requisicao));
+        if (ts[j].reqs == NULL) {
+            perror("Erro ao alocar as requisicoes da thread");
+            exit(EXIT_FAILURE);
         }
+        ts[j].qtd = 0;
+        tabela_iniciar(&ts[j].blocos, 64);
+    }
+    for (long i = 0; i < v->qtd; i++) {
+        Trabalhador *t = &ts[hash_pid(v->itens[i].id) % n];
+        t->reqs[t->qtd++] = v->itens[i];
     }
-    free(primeiro); // Libera o próprio primeiro bloco
-    primeiro = NULL;
-    ultimo_alocado = NULL;
-    printf("\nMemoria limpa.\n");
-}
 
-void Runcircularfit(int tam_total_memoria) {
-    iniciar_memoria(tam_total_memoria);
+    double inicio = agora_ns();
+    for (int j = 0; j < n; j++) pthread_create(&ts[j].thread, NULL, executar_trabalhador, &ts[j]);
+    for (int j = 0; j < n; j++) pthread_join(ts[j].thread, NULL);
+    double fim = agora_ns();
 
-    processar_requisicoes_arquivo("entrada.txt");
+    memset(res, 0, sizeof(ResultadoConcorrente));
+    res->threads = n;
+    res->segundos = (fim - inicio) / 1e9;
+    res->aquisicoes = arena.aquisicoes;
+    res->contencoes = arena.contencoes;
+    for (int j = 0; j < n; j++) {
+        res->acertos += ts[j].acertos;
+        res->alocacoes += ts[j].alocacoes;
+        res->falhas += ts[j].falhas;
+        res->liberacoes += ts[j].liberacoes;
+        free(ts[j].reqs);
+        tabela_limpar(&ts[j].blocos);
+    }
+    free(ts);
+    arena_destruir(&arena);
+    return true;
+}
 
-    limpar_memoria();
+void imprimir_concorrente(const ResultadoConcorrente *r, long requisicoes, double base) {
+    double vazao = requisicoes / r->segundos;
+    double pct_contencao = r->aquisicoes ? 100.0 * r->contencoes / r->aquisicoes : 0;
+    double pct_acertos = r->alocacoes ? 100.0 * r->acertos / r->alocacoes : 0;
+    if (formato_saida == SAIDA_CSV) {
+        printf("%d,%.6f,%.0f,%ld,%ld,%ld,%ld,%ld,%ld\n", r->threads, r->segundos, vazao, r->aquisicoes,
+               r->contencoes, r->acertos, r->alocacoes, r->falhas, r->liberacoes);
+    } else if (formato_saida == SAIDA_JSON) {
+        printf("{\"threads\": %d, \"tempo_s\": %.6f, \"requisicoes_por_s\": %.0f, \"aquisicoes\": %ld, "
+               "\"contencoes\": %ld, \"acertos_cache\": %ld, \"alocacoes\": %ld, \"falhas\": %ld, \"liberacoes\": %ld}\n",
+               r->threads, r->segundos, vazao, r->aquisicoes, r->contencoes, r->acertos,
+               r->alocacoes, r->falhas, r->liberacoes);
+    } else {
+        printf("%-8d %-10.3f %-13.0f %-7.2f %-11ld %-10.1f %-9.1f %ld\n", r->threads, r->segundos, vazao,
+               base / r->segundos, r->aquisicoes, pct_contencao, pct_acertos, r->falhas);
+    }
 }
 
-// ----- Worst-Fit -------------------
-void alocar_memoria_worst_fit(char id_proc, int tam_req) {
-    printf("\nRequisicao: IN(%c, %d) - Worst-Fit\n", id_proc, tam_req);
+// Replay concorrente com 1, 2, 4, ... até max_threads threads, mostrando como vazão e contenção escalam
+int Runconcorrente(int politica, const char *nome_politica, uint64_t tam_mem, const char *nome_arquivo, int max_threads) {
+    VetorRequisicoes v;
+    memset(&v, 0, sizeof(v));
+    int status = processar_requisicoes(nome_arquivo, acumular_requisicao, &v);
+    if (status != 0) return status;
 
-    if (primeiro == NULL) {
-        printf("Erro: Memoria nao inicializada.\n");
-        return;
+    if (formato_saida == SAIDA_CSV) {
+        printf("threads,tempo_s,requisicoes_por_s,aquisicoes,contencoes,acertos_cache,alocacoes,falhas,liberacoes\n");
+    } else if (formato_saida == SAIDA_TEXTO) {
+        printf("\n--- Execucao concorrente (%s, %" PRIu64 " KB, %ld requisicoes) ---\n", nome_politica, tam_mem, v.qtd);
+        printf("%-8s %-10s %-13s %-7s %-11s %-10s %-9s %s\n", "Threads", "Tempo (s)", "Req/s", "Ganho",
+               "Travas", "Cont. (%)", "Cache (%)", "Falhas");
     }
 
-    Bloco *atual = primeiro;
-    Bloco *bloco_worst_fit = NULL; // Este será o bloco final escolhido
-    int maior_tam_livre = -1;     // Para rastrear o tamanho do maior bloco livre elegível
-
-    // Passo 1: Percorrer todos os blocos para encontrar o maior bloco livre que se encaixa
-    do {
-        // Verifica se o bloco atual está livre e se o tamanho dele é suficiente para a requisição
-        if (!atual->alocado && atual->tam >= tam_req) {
-            // Se o tamanho do bloco atual é maior do que o maior tamanho livre encontrado até agora
-            if (atual->tam > maior_tam_livre) {
-                maior_tam_livre = atual->tam; // Atualiza o maior tamanho livre
-                bloco_worst_fit = atual;      // Este bloco é o novo candidato a pior ajuste
-            }
+    double base = 0;
+    for (int n = 1; ; n = (n * 2 < max_threads) ? n * 2 : max_threads) {
+        ResultadoConcorrente res;
+        if (!medir_concorrente(politica, tam_mem, &v, n, &res)) {
+            status = -1;
+            break;
         }
-        atual = atual->prox;
-    } while (atual != primeiro); // Continua até ter percorrido a lista inteira
+        if (n == 1) base = res.segundos;
+        imprimir_concorrente(&res, v.qtd, base);
+        if (n == max_threads) break;
+    }
+    free(v.itens);
+    return status;
+}
 
-    // Passo 2: Tentar alocar no bloco encontrado (se houver)
-    if (bloco_worst_fit != NULL) {
-        if (bloco_worst_fit->tam == tam_req) {
-            // Encaixe perfeito no maior bloco livre (não há fragmentação interna)
-            bloco_worst_fit->id = id_proc;
-            bloco_worst_fit->alocado = true;
-            printf("Alocado %d KB para o processo %c (encaixe perfeito no maior bloco).\n", tam_req, id_proc);
-        } else {
-            // Divide o maior bloco existente
-            Bloco *novo_bloco_livre = criar_bloco(
-                ' ',
-                bloco_worst_fit->tam - tam_req,
-                bloco_worst_fit->end_ini + tam_req,
-                false
-            );
-
-            // Insere o novo bloco livre APÓS o bloco alocado
-            novo_bloco_livre->prox = bloco_worst_fit->prox;
-            novo_bloco_livre->ant = bloco_worst_fit;
-            if (bloco_worst_fit->prox != NULL) { // Garante que não é o único bloco na lista circular
-                bloco_worst_fit->prox->ant = novo_bloco_livre;
-            }
-            bloco_worst_fit->prox = novo_bloco_livre;
+// ------------- Varredura de parametros -------------------
+// Roda o mesmo trace em uma grade de políticas x tamanhos de memória. O trace é lido uma vez;
+// cada configuração roda em uma instância própria, em um conjunto de threads (uma por núcleo),
+// e os resultados saem num único CSV, na ordem da grade.
+#define MAX_VARREDURA 64     // Máximo de políticas e de tamanhos na grade
 
-            // Atualiza o bloco original (agora alocado)
-            bloco_worst_fit->id = id_proc;
-            bloco_worst_fit->tam = tam_req;
-            bloco_worst_fit->alocado = true;
+typedef struct Configuracao {
+    int politica;
+    uint64_t tam_mem;
+    Resumo resumo;
+    double ns_por_op;
+    bool ok;
+} Configuracao;
 
-            printf("Alocado %d KB para o processo %c (maior bloco dividido, %d KB restantes).\n", tam_req, id_proc, novo_bloco_livre->tam);
-        }
+typedef struct Varredura {
+    Configuracao *configs;
+    int qtd;
+    int proxima;                // Próxima configuração a ser pega por uma thread
+    pthread_mutex_t trava;
+    const VetorRequisicoes *reqs;
+} Varredura;
+
+// Replay de todas as requisições em uma instância nova da política
+void rodar_configuracao(Configuracao *c, const VetorRequisicoes *v) {
+    double inicio = agora_ns();
+    if (c->politica == POLITICA_BUDDY) {
+        MemoriaBuddy m;
+        IniciaBuddy(&m, c->tam_mem, max_adiados); // Sem a réplica, que entraria em ns_por_op
+        for (long i = 0; i < v->qtd; i++) executar_buddy(&m, &v->itens[i]);
+        ResumoBuddy(&m, &c->resumo);
+        DestroyBuddy(&m);
+    } else if (c->politica == POLITICA_BUDDY2) {
+        ArvoreBuddy a;
+        if (!InitArvore(&a, c->tam_mem)) return;
+        for (long i = 0; i < v->qtd; i++) executar_arvore(&a, &v->itens[i]);
+        ResumoArvore(&a, &c->resumo);
+        DestroyArvore(&a);
     } else {
-        printf("ESPACO INSUFICIENTE DE MEMORIA para o processo %c.\n", id_proc);
+        MemoriaVariavel m;
+        ExecutarRequisicao executar = executor_variavel(c->politica);
+        iniciar_memoria(&m, c->politica, c->tam_mem);
+        for (long i = 0; i < v->qtd; i++) executar(&m, &v->itens[i]);
+        resumo_variavel(&m, &c->resumo);
+        limpar_memoria(&m);
     }
-    mostrar_memoria();
+    c->ns_por_op = v->qtd ? (agora_ns() - inicio) / v->qtd : 0;
+    c->ok = true;
 }
 
-void processar_requisicoes_arquivo_worst_fit(const char *nome_arquivo) {
-    FILE *arquivo = fopen(nome_arquivo, "r");
-    if (arquivo == NULL) {
-        perror("Erro ao abrir o arquivo de requisicoes");
-        return;
+void* executar_varredura(void *arg) {
+    Varredura *var = arg;
+    while (1) {
+        pthread_mutex_lock(&var->trava);
+        int i = var->proxima++;
+        pthread_mutex_unlock(&var->trava);
+        if (i >= var->qtd) return NULL;
+        rodar_configuracao(&var->configs[i], var->reqs);
     }
+}
 
-    char linha[100];
-    char comando[5];
-    char id_processo;
-    int tamanho;
-
-    while (fgets(linha, sizeof(linha), arquivo) != NULL) {
-        linha[strcspn(linha, "\n")] = 0; 
+int Runvarredura(const int *politicas, int qtd_politicas, const uint64_t *tamanhos, int qtd_tamanhos,
+                 const char *nome_arquivo, int jobs) {
+    VetorRequisicoes v;
+    memset(&v, 0, sizeof(v));
+    int status = processar_requisicoes(nome_arquivo, acumular_requisicao, &v);
+    if (status != 0) return status;
 
-        if (sscanf(linha, "IN(%c,%d)", &id_processo, &tamanho) == 2) {
-            alocar_memoria_worst_fit(id_processo, tamanho); 
-        }
-        else if (sscanf(linha, "OUT(%c)", &id_processo) == 1) {
-            liberar_memoria(id_processo); 
-        } else {
-            printf("Linha invalida no arquivo: %s\n", linha);
+    Varredura var;
+    memset(&var, 0, sizeof(var));
+    var.qtd = qtd_politicas * qtd_tamanhos;
+    var.configs = calloc(var.qtd, sizeof(Configuracao));
+    if (var.configs == NULL) {
+        perror("Erro ao alocar a varredura");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < qtd_politicas; i++) {
+        for (int j = 0; j < qtd_tamanhos; j++) {
+            var.configs[i * qtd_tamanhos + j].politica = politicas[i];
+            var.configs[i * qtd_tamanhos + j].tam_mem = tamanhos[j];
         }
     }
+    var.reqs = &v;
+    pthread_mutex_init(&var.trava, NULL);
 
-    fclose(arquivo);
+    if (jobs > var.qtd) jobs = var.qtd;
+    pthread_t threads[jobs];
+    for (int i = 0; i < jobs; i++) pthread_create(&threads[i], NULL, executar_varredura, &var);
+    for (int i = 0; i < jobs; i++) pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&var.trava);
+
+    printf(CABECALHO_CSV ",ns_por_op\n");
+    for (int i = 0; i < var.qtd; i++) {
+        if (!var.configs[i].ok) {
+            status = -1; // Ex.: árvore implícita grande demais; o erro já foi informado
+            continue;
+        }
+        imprimir_campos_csv(&var.configs[i].resumo);
+        printf(",%.1f\n", var.configs[i].ns_por_op);
+    }
+    free(var.configs);
+    free(v.itens);
+    return status;
 }
 
-void Runworst_fit(int tam_mem){
-    iniciar_memoria(tam_mem);
+// ------------- Suite de benchmarks -------------------
+// Cargas sintéticas geradas em memória com semente fixa: tamanhos uniformes, log-normais ou
+// concentrados em potências de 2, e OUTs em ordem LIFO, FIFO ou aleatória. Cada carga enche o
+// conjunto vivo, faz rotatividade em regime (um OUT seguido de um IN) e depois esvazia a memória.
+#define DIST_UNIFORME 0         // 1 a 64 KB
+#define DIST_LOGNORMAL 1        // Mediana de 8 KB, cauda até SUITE_TAM_MAX
+#define DIST_POT2 2             // 90% potências de 2 de 1 a 64 KB
+#define ORDEM_LIFO 0
+#define ORDEM_FIFO 1
+#define ORDEM_ALEATORIA 2
+#define SUITE_TROCAS 2          // Trocas (OUT + IN) por processo vivo na fase de rotatividade
+#define SUITE_TAM_MAX 1024      // Maior pedido gerado (KB)
+#define SUITE_FOLGA 4           // Memória = potência de 2 >= SUITE_FOLGA x pico de KB vivos
 
-    processar_requisicoes_arquivo_worst_fit("entrada.txt");
+uint64_t semente_suite = 42;    // Mesma semente, mesmas cargas
 
-    limpar_memoria();
-}
-// ------------- BUDDY -------------------
-int tam_mem;
+const char *nomes_distribuicoes[] = {"uniforme", "lognormal", "pot2"};
+const char *nomes_ordens[] = {"lifo", "fifo", "aleatoria"};
+const long suite_vivos[] = {1000, 10000, 100000};
 
-// Estrutura de Block de memória (Buddy)
-typedef struct BlockBuddy {
-    int inicio;          // Início do Block na memória
-    int tam;             // Tamanho do Block
-    int status;          // 1 se está livre, 0 se está alocado
-    char pid[10];        // ID do processo
-    int tam_pedido;      // Tamanho realmente pedido pelo processo
-    char lado;           // 'L', 'R' ou '-' para raiz
-    struct BlockBuddy* next; // Próximo Block
-} BlockBuddy;
+// xorshift64*: rápido e reprodutível entre plataformas
+uint64_t sortear(uint64_t *estado) {
+    uint64_t x = *estado;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *estado = x;
+    return x * 2685821657736338717ull;
+}
 
-// Cria e inicializa primeiro bloco do buddy
-BlockBuddy* InitBlock(int tam_total) {
-    BlockBuddy* Block = malloc(sizeof(BlockBuddy));
-    Block->inicio = 0;          
-    Block->tam = tam_total;     
-    Block->lado = '-';     
-    Block->status = 1;
-    strcpy(Block->pid, "");
-    Block->tam_pedido = 0;
-    Block->next = NULL;
-    return Block;
+// Uniforme em [0, 1)
+double sortear_unitario(uint64_t *estado) {
+    return (sortear(estado) >> 11) * (1.0 / 9007199254740992.0);
 }
 
-// Divide recursivamente o Block até chegar no tamanho desejado
-void SplitBlock(BlockBuddy* Block, int target) {
-    while (Block->tam / 2 >= target) {
-        BlockBuddy* buddy = malloc(sizeof(BlockBuddy)); // Cria um novo bloco de metade do tamanho 
-        buddy->tam = Block->tam / 2;                    
-        buddy->inicio = Block->inicio + buddy->tam;     
-        buddy->status = 1;
-        strcpy(buddy->pid, "");
-        buddy->tam_pedido = 0;
-        buddy->lado = 'R';
-        buddy->next = Block->next;
+uint64_t sortear_tamanho(int dist, uint64_t *estado) {
+    if (dist == DIST_UNIFORME) return 1 + sortear(estado) % 64;
+    if (dist == DIST_POT2) {
+        uint64_t r = sortear(estado);
+        return r % 10 ? 1ull << ((r >> 8) % 7) : 1 + (r >> 16) % 64;
+    }
+    // Log-normal por Box-Muller
+    double u1 = 1.0 - sortear_unitario(estado), u2 = sortear_unitario(estado);
+    double z = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+    double tam = 8.0 * exp(z);
+    if (tam < 1) return 1;
+    if (tam > SUITE_TAM_MAX) return SUITE_TAM_MAX;
+    return (uint64_t)tam;
+}
 
-        Block->tam = buddy->tam;
-        Block->next = buddy;
-        Block->lado = 'L';         // Prioriza o bloco esquerdo a cada split
+// Gera a carga em v. Retorna o maior total de KB vivos ao mesmo tempo.
+uint64_t gerar_carga(VetorRequisicoes *v, int dist, int ordem, long vivos) {
+    uint64_t estado = semente_suite ^ 0x9E3779B97F4A7C15ull;
+    if (estado == 0) estado = 1;
+    long total_ids = vivos * (1 + SUITE_TROCAS);
+    uint32_t *fila = malloc(vivos * sizeof(uint32_t));      // IDs vivos (anel, para o FIFO)
+    uint64_t *tams = malloc(total_ids * sizeof(uint64_t));  // Tamanho de cada ID
+    if (fila == NULL || tams == NULL) {
+        perror("Erro ao gerar a carga");
+        exit(EXIT_FAILURE);
+    }
+    long ini = 0, qtd = 0;
+    uint32_t proximo_id = 0;
+    uint64_t vivo_kb = 0, pico_kb = 0;
+    Requisicao req;
 
-        printf("Dividindo Block de %d KB em %d L e %d R\n",
-                       Block->tam * 2, Block->tam, buddy->tam);
+    v->qtd = 0;
+    for (long passo = 0; passo < vivos * (2 + 2 * SUITE_TROCAS); passo++) {
+        bool entra = passo < vivos || (passo < vivos * (1 + 2 * SUITE_TROCAS) && (passo - vivos) % 2 == 1);
+        if (entra) {
+            req.op = REQ_IN;
+            req.id = proximo_id++;
+            req.tam = tams[req.id] = sortear_tamanho(dist, &estado);
+            fila[(ini + qtd++) % vivos] = req.id;
+            vivo_kb += req.tam;
+            if (vivo_kb > pico_kb) pico_kb = vivo_kb;
+        } else {
+            long pos;
+            if (ordem == ORDEM_LIFO) pos = (ini + qtd - 1) % vivos;
+            else if (ordem == ORDEM_FIFO) pos = ini;
+            else pos = (ini + (long)(sortear(&estado) % qtd)) % vivos;
+            req.op = REQ_OUT;
+            req.id = fila[pos];
+            req.tam = 0;
+            if (ordem == ORDEM_FIFO) ini = (ini + 1) % vivos;
+            else fila[pos] = fila[(ini + qtd - 1) % vivos]; // Tapa o buraco com o último
+            qtd--;
+            vivo_kb -= tams[req.id];
+        }
+        acumular_requisicao(v, &req);
     }
+    free(fila);
+    free(tams);
+    return pico_kb;
 }
 
-// Aloca memória usando Buddy
-int AllocBlock(BlockBuddy* head, char* pid, int tam_req) {
-    int tam_alocado = 1;
-    while (tam_alocado < tam_req) tam_alocado <<= 1; // Arredonda para a potência de 2 mais próxima (ex: Req 30kb, tam 32kb)
+typedef struct ResultadoSuite {
+    double segundos;
+    double *lat_in;         // Latência de cada IN (ns)
+    double *lat_out;        // Latência de cada OUT (ns)
+    long qtd_in;
+    long qtd_out;
+    long falhas;
+    uint64_t metadados;     // Pico de memória de controle (bytes)
+} ResultadoSuite;
 
-    BlockBuddy* atual = head;
-    while (atual) {
-        if (atual->status && atual->tam > tam_alocado) // Divide bloco se o tamanho ainda não é o mínimo para o processo 
-            SplitBlock(atual, tam_alocado);
+// Replay cronometrando cada requisição
+void replay_medido(ExecutarRequisicao executar, void *contexto, const VetorRequisicoes *v, ResultadoSuite *res) {
+    double inicio = agora_ns();
+    for (long i = 0; i < v->qtd; i++) {
+        double t0 = agora_ns();
+        executar(contexto, &v->itens[i]);
+        double dt = agora_ns() - t0;
+        if (v->itens[i].op == REQ_IN) res->lat_in[res->qtd_in++] = dt;
+        else res->lat_out[res->qtd_out++] = dt;
+    }
+    res->segundos = (agora_ns() - inicio) / 1e9;
+}
 
-        if (atual->status && atual->tam == tam_alocado) {  // Aloca se bloco livre com o menor tamanho
-            atual->status = 0;                             
-            atual->tam_pedido = tam_req;
-            strcpy(atual->pid, pid);
-            printf("> Alocando %s com tamanho %d para Block [%d %c]\n",
-                            pid, tam_req, atual->tam, atual->lado);
-            return atual->inicio;
-        }
-        atual = atual->next;
+// Roda uma carga em uma instância nova. Retorna false se a instância não pôde ser criada.
+bool medir_carga(int politica, uint64_t tam, const VetorRequisicoes *v, ResultadoSuite *res) {
+    res->qtd_in = res->qtd_out = 0;
+    if (politica == POLITICA_BUDDY) {
+        MemoriaBuddy m;
+        IniciaBuddy(&m, tam, max_adiados); // Sem a réplica, que entraria nas latências
+        replay_medido(executar_buddy, &m, v, res);
+        res->falhas = m.cont.falhas;
+        res->metadados = MetadadosBuddy(&m);
+        DestroyBuddy(&m);
+    } else if (politica == POLITICA_BUDDY2) {
+        ArvoreBuddy a;
+        if (!InitArvore(&a, tam)) return false;
+        replay_medido(executar_arvore, &a, v, res);
+        res->falhas = a.cont.falhas;
+        res->metadados = MetadadosArvore(&a);
+        DestroyArvore(&a);
+    } else {
+        MemoriaVariavel m;
+        iniciar_memoria(&m, politica, tam);
+        replay_medido(executor_variavel(politica), &m, v, res);
+        res->falhas = m.cont.falhas;
+        res->metadados = metadados_variavel(&m);
+        limpar_memoria(&m);
     }
+    return true;
+}
 
-    printf("ESPACO INSUFICIENTE DE MEMORIA\n");
-    return -1;
+int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
 }
 
+// Percentil p (0 a 1) de um vetor já ordenado
+double percentil(const double *v, long n, double p) {
+    return n ? v[(long)(p * (n - 1))] : 0;
+}
 
-// Libera memória associada a um processo e tenta juntar Blocks
-void FreeBlock(BlockBuddy *head, char *pid)
-{
-    BlockBuddy *atual = head;
-    while (atual)   // Libera memória do processo 
-    {
-        if (!atual->status && strcmp(atual->pid, pid) == 0)
-        {
-            atual->status = 1;        
-            atual->tam_pedido = 0;
-            strcpy(atual->pid, "");
-            break;
-        }
-        atual = atual->next;
+void imprimir_suite(const char *politica, int dist, int ordem, long vivos, uint64_t tam, ResultadoSuite *r) {
+    qsort(r->lat_in, r->qtd_in, sizeof(double), comparar_double);
+    qsort(r->lat_out, r->qtd_out, sizeof(double), comparar_double);
+    long ops = r->qtd_in + r->qtd_out;
+    double vazao = ops / r->segundos;
+    double in50 = percentil(r->lat_in, r->qtd_in, 0.5), in99 = percentil(r->lat_in, r->qtd_in, 0.99);
+    double out50 = percentil(r->lat_out, r->qtd_out, 0.5), out99 = percentil(r->lat_out, r->qtd_out, 0.99);
+    double meta_kb = r->metadados / 1024.0;
+    if (formato_saida == SAIDA_CSV) {
+        printf("%s,%s,%s,%ld,%" PRIu64 ",%ld,%.0f,%.0f,%.0f,%.0f,%.0f,%ld,%.1f\n", politica, nomes_distribuicoes[dist],
+               nomes_ordens[ordem], vivos, tam, ops, vazao, in50, in99, out50, out99, r->falhas, meta_kb);
+    } else if (formato_saida == SAIDA_JSON) {
+        printf("{\"politica\": \"%s\", \"distribuicao\": \"%s\", \"ordem\": \"%s\", \"vivos\": %ld, "
+               "\"memoria_kb\": %" PRIu64 ", \"operacoes\": %ld, \"ops_por_s\": %.0f, \"in_p50_ns\": %.0f, "
+               "\"in_p99_ns\": %.0f, \"out_p50_ns\": %.0f, \"out_p99_ns\": %.0f, \"falhas\": %ld, \"metadados_kb\": %.1f}\n",
+               politica, nomes_distribuicoes[dist], nomes_ordens[ordem], vivos, tam, ops, vazao,
+               in50, in99, out50, out99, r->falhas, meta_kb);
+    } else {
+        printf("%-9s %-10s %-10s %-8ld %-11.0f %-8.0f %-8.0f %-8.0f %-8.0f %-7ld %.1f\n", politica,
+               nomes_distribuicoes[dist], nomes_ordens[ordem], vivos, vazao, in50, in99, out50, out99,
+               r->falhas, meta_kb);
     }
+}
 
-    atual = head;
-    while (atual && atual->next) // Junta blocos adjacentes se ambos livres
-    {
-        if (atual->status && atual->next->status &&
-            atual->tam == atual->next->tam &&
-            atual->inicio % (2 * atual->tam) == 0)
-        {
+// Roda todas as cargas sintéticas em cada política (ou só em uma, se politica != 0)
+int Runsuite(int politica) {
+    const char *nomes_politicas[] = {"", "worst", "circular", "buddy", "buddy2", "tlsf"};
+    long max_vivos = suite_vivos[sizeof(suite_vivos) / sizeof(suite_vivos[0]) - 1];
+    long max_ops = max_vivos * (2 + 2 * SUITE_TROCAS);
+    VetorRequisicoes v;
+    ResultadoSuite res;
+    memset(&v, 0, sizeof(v));
+    memset(&res, 0, sizeof(res));
+    res.lat_in = malloc(max_ops * sizeof(double));
+    res.lat_out = malloc(max_ops * sizeof(double));
+    if (res.lat_in == NULL || res.lat_out == NULL) {
+        perror("Erro ao alocar as latencias");
+        exit(EXIT_FAILURE);
+    }
 
-            atual->tam *= 2;
-            BlockBuddy *temp = atual->next;
-            atual->next = temp->next;
-            free(temp);
-            atual = head;
-            continue;
+    if (formato_saida == SAIDA_CSV) {
+        printf("politica,distribuicao,ordem,vivos,memoria_kb,operacoes,ops_por_s,in_p50_ns,in_p99_ns,"
+               "out_p50_ns,out_p99_ns,falhas,metadados_kb\n");
+    } else if (formato_saida == SAIDA_TEXTO) {
+        printf("\n--- Suite de benchmarks (semente %" PRIu64 ", latencias em ns) ---\n", semente_suite);
+        printf("%-9s %-10s %-10s %-8s %-11s %-8s %-8s %-8s %-8s %-7s %s\n", "Politica", "Tamanhos", "Ordem",
+               "Vivos", "Ops/s", "IN p50", "IN p99", "OUT p50", "OUT p99", "Falhas", "Meta KB");
+    }
+    int status = 0;
+    for (size_t i = 0; i < sizeof(suite_vivos) / sizeof(suite_vivos[0]); i++) {
+        for (int dist = DIST_UNIFORME; dist <= DIST_POT2; dist++) {
+            for (int ordem = ORDEM_LIFO; ordem <= ORDEM_ALEATORIA; ordem++) {
+                uint64_t pico_kb = gerar_carga(&v, dist, ordem, suite_vivos[i]);
+                uint64_t tam = 1ull << ordem_minima;
+                while (tam < SUITE_FOLGA * pico_kb) tam <<= 1;
+                for (int p = POLITICA_WORST_FIT; p <= POLITICA_TLSF; p++) {
+                    if (politica != 0 && p != politica) continue;
+                    if (!medir_carga(p, tam, &v, &res)) {
+                        status = -1;
+                        continue;
+                    }
+                    imprimir_suite(nomes_politicas[p], dist, ordem, suite_vivos[i], tam, &res);
+                }
+            }
         }
-        atual = atual->next;
     }
+    free(res.lat_in);
+    free(res.lat_out);
+    free(v.itens);
+    return status;
 }
 
-// Calcula fragmentação interna
-int InnerFrag(BlockBuddy* head) {
-    int frag = 0;
-    while (head) {
-        if (!head->status && head->tam_pedido > 0)
-            frag += head->tam - head->tam_pedido; // Diferença entre tamanho alocado e o da requisição
-        head = head->next;
-    }
-    return frag;
-}
+// ---- Conversão texto -> binário ----
+typedef struct ConversaoBinaria {
+    FILE *arquivo;          // Saída da conversão
+    uint32_t processos;     // Maior ID gravado + 1
+    uint64_t registros;
+} ConversaoBinaria;
 
-void PrintBuddy(BlockBuddy* head) {
-    printf("-----------------------------------------------------------------------\n");
-    printf("Path:                        Size:      Allocated (PID): Int. Frag.\n");
-    printf("-----------------------------------------------------------------------\n");
+void escrever_registro(void *contexto, Requisicao *req) {
+    ConversaoBinaria *c = contexto;
+    // O ID internado já é numérico, na ordem em que o nome aparece pela primeira vez
+    RegistroBinario reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.op = req->op;
+    reg.id = req->id;
+    if (req->id >= c->processos) c->processos = req->id + 1;
+    reg.tam = req->tam;
+    fwrite(&reg, sizeof(reg), 1, c->arquivo);
+    c->registros++;
+}
 
-    BlockBuddy* current = head;
-    int total_allocated = 0;
-    int total_frag = 0;
-    int total_memory = 0;
+// Converte um arquivo de requisições em texto para o formato binário
+int converter_para_binario(const char *entrada, const char *saida) {
+    ConversaoBinaria c;
+    memset(&c, 0, sizeof(c));
+    c.arquivo = fopen(saida, "wb");
+    if (c.arquivo == NULL) {
+        perror("Erro ao criar o arquivo binario");
+        return -1;
+    }
+    CabecalhoBinario cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magica, MAGICA_BINARIO, 4);
+    cab.versao = VERSAO_BINARIO;
+    fwrite(&cab, sizeof(cab), 1, c.arquivo);
 
-    while (current) {
-        // Path: e.g., 128L -> 64L -> 32L
-        int path_start = current->inicio;
-        int path_size = current->tam;
-        char path[256] = "";
-        char seg[32];
-        int rev[10], depth = 0;         // Profundidade de árvore e Caminho inverso do bloco
+    int status = processar_requisicoes(entrada, escrever_registro, &c);
 
-         while (path_size < tam_mem)
-        {
-            int parent_size = path_size * 2;
-            int is_left = (path_start % parent_size == 0);
-            rev[depth++] = is_left;
-            path_size = parent_size;
-            if (!is_left) {
-                path_start = path_start - path_size / 2;
-            }
-        }
+    // Agora que a quantidade é conhecida, completa o cabeçalho
+    cab.qtd_registros = c.registros;
+    if (fseek(c.arquivo, 0, SEEK_SET) == 0) {
+        fwrite(&cab, sizeof(cab), 1, c.arquivo);
+    }
+    if (fclose(c.arquivo) != 0) {
+        perror("Erro ao gravar o arquivo binario");
+        status = -1;
+    }
 
-        // Mostra caminho do bloco raiz -> bloco alocado
-       int tmp_size = tam_mem;
-        for (int i = depth - 1; i >= 0; i--) {
-            tmp_size /= 2;
-            snprintf(seg, sizeof(seg), "%d%s -> ", tmp_size, rev[i] ? "L" : "R");
-            strcat(path, seg);
-        }
+    if (status == 0) {
+        fprintf(stderr, "%llu requisicoes convertidas (%u processos distintos) para %s\n",
+                (unsigned long long)c.registros, c.processos, saida);
+    }
+    return status;
+}
 
-        int len = strlen(path);
-        if (len >= 4) path[len - 4] = '\0'; // Remove o " -> " final
+// Lê um tamanho em KB com sufixo opcional: "512", "64M" (64 * 2^10 KB), "4T" (4 * 2^30 KB).
+// Retorna 0 se o texto não é um tamanho válido.
+uint64_t ler_tamanho(const char *texto) {
+    char *fim;
+    uint64_t valor = strtoull(texto, &fim, 10);
+    int deslocamento = 0;
+    if (fim == texto || texto[0] == '-') return 0;
+    switch (*fim) {
+        case '\0': case 'K': case 'k': break;
+        case 'M': case 'm': deslocamento = 10; break;
+        case 'G': case 'g': deslocamento = 20; break;
+        case 'T': case 't': deslocamento = 30; break;
+        default: return 0;
+    }
+    if (*fim != '\0' && fim[1] != '\0') return 0;
+    if (valor > (UINT64_MAX >> deslocamento)) return 0;
+    return valor << deslocamento;
+}
 
-        char size_str[16];
-        snprintf(size_str, sizeof(size_str), "%d KB", current->tam);
-        total_memory += current->tam;
+#define SAIDA_OK 0
+#define SAIDA_ERRO_EXECUCAO 1   // Ex.: arquivo de requisições não encontrado
+#define SAIDA_ERRO_USO 2        // Argumentos inválidos
 
-        char alloc_str[32] = "-";
-        char frag_str[16] = "-";
+void uso(const char *programa) {
+    fprintf(stderr,
+        "Uso: %s [opcoes]\n"
+        "Sem opcoes, abre o menu interativo.\n\n"
+        "  -p, --politica worst|circular|tlsf|buddy|buddy2\n"
+        "                                       Politica de alocacao (buddy2 = buddy em arvore implicita)\n"
+        "  -m, --memoria N[K|M|G|T]             Tamanho da memoria em KB (potencia de 2); M, G e T multiplicam por 2^10, 2^20 e 2^30 KB\n"
+        "  -o, --ordem-minima K                 Buddy: menor Block tem 2^K KB (padrao: 0)\n"
+        "  -e, --entrada ARQUIVO                Arquivo de requisicoes, texto ou binario ('-' = entrada padrao; padrao: entrada.txt)\n"
+        "  -f, --formato texto|csv|json         Formato do resumo final (csv e json implicam --silencioso)\n"
+        "  -C, --compactar                      Particionamento variavel: se nenhum bloco comporta o pedido mas o total\n"
+        "                                       livre basta, compacta a memoria e tenta de novo\n"
+        "  -a, --adiar N                        Buddy: adia as fusoes de ate N Blocks livres por ordem (limitado a 1/8 da\n"
+        "                                       memoria por ordem); elas so sao feitas quando um pedido nao cabe. O resumo\n"
+        "                                       compara divisoes e fusoes com a mesma execucao com fusao imediata\n"
+        "  -k, --slab                           Buddy: pedidos de ate 16 KB viram objetos de classes fixas (1, 2, 3, 4,\n"
+        "                                       6, 8, 12 e 16 KB) recortados de slabs de 64 KB; relatorio por classe\n"
+        "  -s, --silencioso                     Nao mostra a memoria a cada requisicao\n"
+        "  -d, --dump N                         No modo silencioso, mostra a memoria a cada N requisicoes\n"
+        "  -i, --instrumentar ARQUIVO           Histogramas por requisicao (nos visitados, divisoes, fusoes, ciclos)\n"
+        "                                       em JSON no fim da execucao e a cada SIGUSR1 ('-' = saida padrao)\n"
+        "  -l, --serie ARQUIVO                  Grava a ocupacao (livre, maior livre, blocos livres, frag. interna, falhas)\n"
+        "                                       a cada N requisicoes ('-' = saida padrao)\n"
+        "  -n, --serie-intervalo N              Requisicoes entre amostras da serie (padrao: 1)\n"
+        "  -F, --serie-formato csv|bin          Formato da serie (padrao: csv)\n"
+        "  -w, --snapshot ARQUIVO               Grava o estado completo da instancia (blocos, livres, indice) apos\n"
+        "                                       --snapshot-em requisicoes (worst, circular, tlsf e buddy)\n"
+        "  -W, --snapshot-em N                  Requisicoes processadas antes do instantaneo\n"
+        "  -R, --restaurar ARQUIVO              Comeca do instantaneo e pula as requisicoes ja refletidas nele\n"
+        "                                       (mesma politica, memoria e entrada da execucao que o gravou)\n"
+        "  -t, --threads N                      Replay concorrente com 1, 2, 4, ... N threads sobre uma arena com trava\n"
+        "                                       e caches por thread; mostra como vazao e contencao escalam\n"
+        "  -v, --varredura                      Varredura: --politica e --memoria aceitam listas separadas por virgula;\n"
+        "                                       cada combinacao roda em uma thread e o resultado sai num unico CSV\n"
+        "  -j, --jobs N                         Varredura: configuracoes rodando ao mesmo tempo (padrao: numero de nucleos)\n"
+        "  -c, --converter SAIDA                Converte o arquivo de --entrada para o formato binario e termina\n"
+        "  -b, --benchmark                      Roda o benchmark Worst-Fit (heap x busca linear)\n"
+        "  -S, --suite                          Roda as cargas sinteticas em todas as politicas (ou so na de --politica):\n"
+        "                                       vazao, latencias p50/p99 de IN e OUT e pico de metadados\n"
+        "  -r, --semente N                      Semente das cargas da suite (padrao: 42)\n"
+        "  -h, --help                           Mostra esta ajuda\n",
+        programa);
+}
 
-        if (!current->status) {
-            snprintf(alloc_str, sizeof(alloc_str), "%d KB (%s)", current->tam_pedido, current->pid);
-            snprintf(frag_str, sizeof(frag_str), "%d KB", current->tam - current->tam_pedido);
-            total_allocated += current->tam_pedido;
-            total_frag += current->tam - current->tam_pedido;
-        }
+// Converte o nome da política na constante POLITICA_*; 0 se for inválido
+int ler_politica(const char *nome) {
+    if (strcmp(nome, "worst") == 0) return POLITICA_WORST_FIT;
+    if (strcmp(nome, "circular") == 0) return POLITICA_CIRCULAR_FIT;
+    if (strcmp(nome, "tlsf") == 0) return POLITICA_TLSF;
+    if (strcmp(nome, "buddy") == 0) return POLITICA_BUDDY;
+    if (strcmp(nome, "buddy2") == 0) return POLITICA_BUDDY2;
+    return 0;
+}
 
-        printf("%-27s %-10s %-17s %s\n", path, size_str, alloc_str, frag_str);
-        current = current->next;
+// Memória válida para a política: potência de dois e, no Buddy, ao menos um Block mínimo
+bool memoria_valida(int politica, uint64_t memoria) {
+    if (memoria == 0 || (memoria & (memoria - 1)) != 0) {
+        fprintf(stderr, "Erro: O tamanho da memoria deve ser uma potencia de dois e positivo.\n");
+        return false;
     }
-
-    printf("-----------------------------------------------------------------------\n");
-    printf("Total                       %3d KB      %3d KB           %d KB\n", total_memory, total_allocated, total_frag);
-    printf("-----------------------------------------------------------------------\n");
-    printf("\n\n");
+    if ((politica == POLITICA_BUDDY || politica == POLITICA_BUDDY2) && memoria < (1ull << ordem_minima)) {
+        fprintf(stderr, "Erro: A memoria e menor que o Block minimo de 2^%d KB.\n", ordem_minima);
+        return false;
+    }
+    return true;
 }
 
+// Varredura: lê as listas de políticas e tamanhos e roda a grade
+int executar_varredura_cli(char *lista_politicas, char *lista_memorias, const char *nome_arquivo, int jobs) {
+    int politicas[MAX_VARREDURA];
+    uint64_t tamanhos[MAX_VARREDURA];
+    int qtd_politicas = 0, qtd_tamanhos = 0;
 
-// Executa um comando lido da entrada
-void execBuddy(BlockBuddy* memoria, const char* linha) {
-    char pid[10];
-    int tam;
+    for (char *item = strtok(lista_politicas, ","); item != NULL; item = strtok(NULL, ",")) {
+        if (qtd_politicas == MAX_VARREDURA) {
+            fprintf(stderr, "Politicas demais na varredura (maximo %d)\n", MAX_VARREDURA);
+            return SAIDA_ERRO_USO;
+        }
+        politicas[qtd_politicas] = ler_politica(item);
+        if (politicas[qtd_politicas] == 0) {
+            fprintf(stderr, "Politica invalida: %s\n", item);
+            return SAIDA_ERRO_USO;
+        }
+        qtd_politicas++;
+    }
+    for (char *item = strtok(lista_memorias, ","); item != NULL; item = strtok(NULL, ",")) {
+        if (qtd_tamanhos == MAX_VARREDURA) {
+            fprintf(stderr, "Tamanhos demais na varredura (maximo %d)\n", MAX_VARREDURA);
+            return SAIDA_ERRO_USO;
+        }
+        tamanhos[qtd_tamanhos++] = ler_tamanho(item);
+    }
+    if (qtd_politicas == 0 || qtd_tamanhos == 0) {
+        fprintf(stderr, "Informe ao menos uma politica e um tamanho de memoria\n");
+        return SAIDA_ERRO_USO;
+    }
+    for (int i = 0; i < qtd_politicas; i++) {
+        for (int j = 0; j < qtd_tamanhos; j++) {
+            if (!memoria_valida(politicas[i], tamanhos[j])) return SAIDA_ERRO_USO;
+        }
+    }
 
-    if (sscanf(linha, "IN(%9[^,],%d)", pid, &tam) == 2) { // Use %9[^,] para evitar buffer overflow
-        printf("> Requisicao: IN(%s, %d)\n", pid, tam);
-        AllocBlock(memoria, pid, tam);
-    } else if (sscanf(linha, "OUT(%9[^)])", pid) == 1) { // Use %9[^)] para evitar buffer overflow
-        printf("> Requisicao: OUT(%s)\n", pid);
-        FreeBlock(memoria, pid);
-    } else {
-        printf("> Linha invalida: %s\n", linha);
+    if (jobs == 0) {
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = nucleos > 0 ? (int)nucleos : 1;
     }
-    PrintBuddy(memoria);
+    modo_silencioso = true; // As configurações rodam em paralelo, sem dumps
+    intervalo_dump = 0;
+    int status = Runvarredura(politicas, qtd_politicas, tamanhos, qtd_tamanhos, nome_arquivo, jobs);
+    return status == 0 ? SAIDA_OK : SAIDA_ERRO_EXECUCAO;
 }
 
-// Roda o particionamento buddy
-void Runbuddy(int tam_mem) {
-    BlockBuddy* memoria = InitBlock(tam_mem);
-    FILE* arq = fopen("entrada.txt", "r"); // Nome do arquivo fixo
-    if (!arq) {
-        perror("Erro ao abrir entrada.txt");
-        return;
+// Execução não interativa, guiada pelos argumentos da linha de comando
+int executar_linha_comando(int argc, char *argv[]) {
+    static struct option opcoes[] = {
+        {"politica",   required_argument, NULL, 'p'},
+        {"memoria",    required_argument, NULL, 'm'},
+        {"ordem-minima", required_argument, NULL, 'o'},
+        {"entrada",    required_argument, NULL, 'e'},
+        {"formato",    required_argument, NULL, 'f'},
+        {"compactar",  no_argument,       NULL, 'C'},
+        {"slab",       no_argument,       NULL, 'k'},
+        {"adiar",      required_argument, NULL, 'a'},
+        {"silencioso", no_argument,       NULL, 's'},
+        {"dump",       required_argument, NULL, 'd'},
+        {"instrumentar", required_argument, NULL, 'i'},
+        {"serie",      required_argument, NULL, 'l'},
+        {"serie-intervalo", required_argument, NULL, 'n'},
+        {"serie-formato", required_argument, NULL, 'F'},
+        {"snapshot",   required_argument, NULL, 'w'},
+        {"snapshot-em", required_argument, NULL, 'W'},
+        {"restaurar",  required_argument, NULL, 'R'},
+        {"threads",    required_argument, NULL, 't'},
+        {"varredura",  no_argument,       NULL, 'v'},
+        {"jobs",       required_argument, NULL, 'j'},
+        {"converter",  required_argument, NULL, 'c'},
+        {"benchmark",  no_argument,       NULL, 'b'},
+        {"suite",      no_argument,       NULL, 'S'},
+        {"semente",    required_argument, NULL, 'r'},
+        {"help",       no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    char *politica = NULL;
+    char *texto_memoria = NULL;
+    const char *nome_arquivo = "entrada.txt";
+    const char *saida_binaria = NULL;
+    const char *arquivo_instrumentacao = NULL;
+    const char *arquivo_serie = NULL;
+    const char *arquivo_snapshot = NULL;
+    const char *arquivo_restauracao = NULL;
+    uint64_t memoria = 0;
+    int threads = 0;
+    bool varredura = false;
+    bool suite = false;
+    int jobs = 0;
+    int opcao;
+    char *fim;
+
+    while ((opcao = getopt_long(argc, argv, "p:m:o:e:f:Cka:sd:i:l:n:F:w:W:R:t:vj:c:bSr:h", opcoes, NULL)) != -1) {
+        switch (opcao) {
+            case 'p':
+                politica = optarg;
+                break;
+            case 'm':
+                texto_memoria = optarg;
+                break;
+            case 'o':
+                ordem_minima = (int)strtol(optarg, &fim, 10);
+                if (*fim != '\0' || ordem_minima < 0 || ordem_minima >= MAX_ORDEM_BUDDY) {
+                    fprintf(stderr, "Ordem minima invalida: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'e':
+                nome_arquivo = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "texto") == 0) formato_saida = SAIDA_TEXTO;
+                else if (strcmp(optarg, "csv") == 0) formato_saida = SAIDA_CSV;
+                else if (strcmp(optarg, "json") == 0) formato_saida = SAIDA_JSON;
+                else {
+                    fprintf(stderr, "Formato invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'C':
+                compactacao = true;
+                break;
+            case 'k':
+                usar_slab = true;
+                break;
+            case 'a':
+                max_adiados = (int)strtol(optarg, &fim, 10);
+                if (*fim != '\0' || max_adiados < 0) {
+                    fprintf(stderr, "Numero de Blocks adiados invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 's':
+                modo_silencioso = true;
+                break;
+            case 'd':
+                intervalo_dump = (int)strtol(optarg, &fim, 10);
+                if (*fim != '\0' || intervalo_dump < 0) {
+                    fprintf(stderr, "Intervalo de dump invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'i':
+                arquivo_instrumentacao = optarg;
+                break;
+            case 'l':
+                arquivo_serie = optarg;
+                break;
+            case 'n':
+                intervalo_serie = strtol(optarg, &fim, 10);
+                if (*fim != '\0' || intervalo_serie < 1) {
+                    fprintf(stderr, "Intervalo da serie invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'F':
+                if (strcmp(optarg, "csv") == 0) formato_serie = SERIE_CSV;
+                else if (strcmp(optarg, "bin") == 0) formato_serie = SERIE_BINARIA;
+                else {
+                    fprintf(stderr, "Formato de serie invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'w':
+                arquivo_snapshot = optarg;
+                break;
+            case 'W':
+                instantaneo_em = strtol(optarg, &fim, 10);
+                if (*fim != '\0' || instantaneo_em < 1) {
+                    fprintf(stderr, "Requisicao do instantaneo invalida: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'R':
+                arquivo_restauracao = optarg;
+                break;
+            case 't':
+                threads = (int)strtol(optarg, &fim, 10);
+                if (*fim != '\0' || threads < 1) {
+                    fprintf(stderr, "Numero de threads invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'v':
+                varredura = true;
+                break;
+            case 'j':
+                jobs = (int)strtol(optarg, &fim, 10);
+                if (*fim != '\0' || jobs < 1) {
+                    fprintf(stderr, "Numero de jobs invalido: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'c':
+                saida_binaria = optarg;
+                break;
+            case 'b':
+                benchmark_worst_fit();
+                return SAIDA_OK;
+            case 'S':
+                suite = true;
+                break;
+            case 'r':
+                semente_suite = strtoull(optarg, &fim, 10);
+                if (*fim != '\0' || optarg[0] == '-') {
+                    fprintf(stderr, "Semente invalida: %s\n", optarg);
+                    return SAIDA_ERRO_USO;
+                }
+                break;
+            case 'h':
+                uso(argv[0]);
+                return SAIDA_OK;
+            default:
+                uso(argv[0]);
+                return SAIDA_ERRO_USO;
+        }
+    }
+
+    if (optind < argc) {
+        fprintf(stderr, "Argumento inesperado: %s\n", argv[optind]);
+        return SAIDA_ERRO_USO;
+    }
+    if (saida_binaria != NULL) {
+        return converter_para_binario(nome_arquivo, saida_binaria) == 0 ? SAIDA_OK : SAIDA_ERRO_EXECUCAO;
+    }
+    if (suite) {
+        int num_politica = politica ? ler_politica(politica) : 0;
+        if (politica != NULL && num_politica == 0) {
+            fprintf(stderr, "Politica invalida: %s\n", politica);
+            return SAIDA_ERRO_USO;
+        }
+        modo_silencioso = true;
+        intervalo_dump = 0;
+        return Runsuite(num_politica) == 0 ? SAIDA_OK : SAIDA_ERRO_EXECUCAO;
+    }
+    if (politica == NULL) {
+        fprintf(stderr, "Informe a politica com --politica\n");
+        return SAIDA_ERRO_USO;
+    }
+    if (varredura) {
+        if (texto_memoria == NULL) {
+            fprintf(stderr, "Informe os tamanhos de memoria com --memoria\n");
+            return SAIDA_ERRO_USO;
+        }
+        return executar_varredura_cli(politica, texto_memoria, nome_arquivo, jobs);
+    }
+    int num_politica = ler_politica(politica);
+    if (num_politica == 0) {
+        fprintf(stderr, "Politica invalida: %s\n", politica);
+        return SAIDA_ERRO_USO;
+    }
+    if (texto_memoria != NULL) memoria = ler_tamanho(texto_memoria);
+    if (!memoria_valida(num_politica, memoria)) return SAIDA_ERRO_USO;
+    if (formato_saida != SAIDA_TEXTO) {
+        modo_silencioso = true; // Dumps por requisição quebrariam o CSV/JSON
     }
 
-    char linha[50];
-    while (fgets(linha, sizeof(linha), arq)) {
-        if (linha[strlen(linha) - 1] == '\n')
-            linha[strlen(linha) - 1] = '\0'; // Remove o '\n'
-        execBuddy(memoria, linha);
+    if (arquivo_instrumentacao != NULL && threads == 0) {
+        saida_instrumentacao = strcmp(arquivo_instrumentacao, "-") == 0 ? stdout : fopen(arquivo_instrumentacao, "w");
+        if (saida_instrumentacao == NULL) {
+            perror("Erro ao abrir o arquivo de instrumentacao");
+            return SAIDA_ERRO_EXECUCAO;
+        }
+        signal(SIGUSR1, pedir_dump);
+    }
+    if (arquivo_serie != NULL && threads == 0) {
+        saida_serie = strcmp(arquivo_serie, "-") == 0 ? stdout
+                    : fopen(arquivo_serie, formato_serie == SERIE_BINARIA ? "wb" : "w");
+        if (saida_serie == NULL) {
+            perror("Erro ao abrir o arquivo da serie");
+            return SAIDA_ERRO_EXECUCAO;
+        }
     }
-    fclose(arq);
 
-    printf("Fragmentacao interna total: %d KB\n", InnerFrag(memoria));
+    if ((arquivo_snapshot != NULL || arquivo_restauracao != NULL) && threads == 0) {
+        if (arquivo_snapshot != NULL && instantaneo_em == 0) {
+            fprintf(stderr, "Informe a requisicao do instantaneo com --snapshot-em\n");
+            return SAIDA_ERRO_USO;
+        }
+        if (num_politica == POLITICA_BUDDY2 || usar_slab || max_adiados > 0) {
+            fprintf(stderr, "Instantaneos nao suportam buddy2, --slab nem --adiar\n");
+            return SAIDA_ERRO_USO;
+        }
+        arquivo_instantaneo = arquivo_snapshot;
+        arquivo_restaurar = arquivo_restauracao;
+    }
 
+    int status;
+    if (threads > 0) {
+        modo_silencioso = true; // As threads não imprimem por requisição
+        status = Runconcorrente(num_politica, politica, memoria, nome_arquivo, threads);
+    } else if (num_politica == POLITICA_WORST_FIT) {
+        status = Runworst_fit(memoria, nome_arquivo);
+    } else if (num_politica == POLITICA_CIRCULAR_FIT) {
+        status = Runcircularfit(memoria, nome_arquivo);
+    } else if (num_politica == POLITICA_TLSF) {
+        status = Runtlsf(memoria, nome_arquivo);
+    } else if (num_politica == POLITICA_BUDDY) {
+        status = Runbuddy(memoria, nome_arquivo);
+    } else {
+        status = Runbuddy2(memoria, nome_arquivo);
+    }
+    if (saida_instrumentacao != NULL && saida_instrumentacao != stdout) fclose(saida_instrumentacao);
+    if (saida_serie != NULL && saida_serie != stdout && fclose(saida_serie) != 0) {
+        perror("Erro ao gravar a serie");
+        status = -1;
+    }
+    return status == 0 ? SAIDA_OK : SAIDA_ERRO_EXECUCAO;
 }
 
 // Função principal
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        return executar_linha_comando(argc, argv);
+    }
+
     int tipo_part;
     int politica = 0;
+    uint64_t tam_mem = 0;
     int menu = 1;
 
     while(menu == 1){
     printf("Escolha o tipo de particionamento:\n");
     printf("1 - Particionamento Variavel\n");
-    printf("2 - Particionamento Definido (Buddy)\n> ");
+    printf("2 - Particionamento Definido (Buddy)\n");
+    printf("3 - Benchmark Worst-Fit (heap x busca linear)\n");
+    printf("4 - Suite de benchmarks (cargas sinteticas)\n> ");
     scanf("%d", &tipo_part);
 
+    if (tipo_part == 3) {
+        benchmark_worst_fit();
+        return 0;
+    }
+    if (tipo_part == 4) {
+        modo_silencioso = true;
+        return Runsuite(0);
+    }
+
     if (tipo_part == 1) {
         printf("Escolha a politica:\n");
         printf("1 - Worst-Fit\n");
-        printf("2 - Circular-Fit\n> ");
+        printf("2 - Circular-Fit\n");
+        printf("3 - TLSF (segregated fit)\n> ");
         scanf("%d", &politica);
     }
 
     printf("Informe o tamanho da memoria principal (em KB, potencia de 2):\n> ");
-    scanf("%d", &tam_mem);
+    scanf("%" SCNu64, &tam_mem);
+
+    printf("Modo de execucao:\n");
+    printf("1 - Interativo (mostra a memoria a cada requisicao)\n");
+    printf("2 - Silencioso (so o resumo final)\n> ");
+    int modo = 1;
+    scanf("%d", &modo);
+    if (modo == 2) {
+        modo_silencioso = true;
+        printf("Mostrar a memoria a cada quantas requisicoes? (0 = nunca)\n> ");
+        scanf("%d", &intervalo_dump);
+    }
 
     // Validação: Tamanho deve ser potência de 2
-    if (tipo_part == 2 && (tam_mem <= 0 || (tam_mem & (tam_mem - 1)) != 0)) {
+    if (tipo_part == 2 && (tam_mem == 0 || (tam_mem & (tam_mem - 1)) != 0)) {
         printf("Erro: Para o Buddy System, o tamanho da memoria deve ser uma potencia de dois e positivo.\n");
-    } else if (tipo_part == 1 && (tam_mem <= 0 || (tam_mem & (tam_mem - 1)) != 0)){
+    } else if (tipo_part == 1 && (tam_mem == 0 || (tam_mem & (tam_mem - 1)) != 0)){
         printf("Erro: O tamanho da memoria deve ser uma potencia de dois e positivo.\n");
     } else {
         menu = 0; 
@@ -629,17 +4486,20 @@ int main() {
         case 1:
             if (politica == 1) { 
                 printf("[!] Particionamento worst-fit.\n");
-                Runworst_fit(tam_mem);
+                Runworst_fit(tam_mem, "entrada.txt");
             } else if (politica == 2) {
                 printf("[!] Particionamento circular-fit.\n");
-                Runcircularfit(tam_mem);
+                Runcircularfit(tam_mem, "entrada.txt");
+            } else if (politica == 3) {
+                printf("[!] Particionamento TLSF.\n");
+                Runtlsf(tam_mem, "entrada.txt");
             } else { 
                 printf("Politica invalida.\n");
             }
             break;
         case 2:
             printf("[!] Particionamento Buddy System.\n"); 
-            Runbuddy(tam_mem);
+            Runbuddy(tam_mem, "entrada.txt");
             break;
         default:
             printf("Tipo de particionamento invalido.\n");